@@ -0,0 +1,158 @@
+/*
+ * Offline analysis of DFU traffic captures.
+ *
+ * Decodes a capture written by CaptureWriter and prints per opcode request counts, failures and response latency.
+ * Sessions can be replayed against the simulated bootloader to find where a device diverged from the expected
+ * protocol behaviour. The simulated bootloader has to be given the MTU and data object size of the captured one.
+ */
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_capture.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto usage() -> int
+    {
+        fmt::print(stderr,
+                   "usage: sdfu_analyze <capture> [--threads <n>]\n"
+                   "                    [--replay <session>]... [--mtu <bytes>] [--max-size <bytes>]\n");
+        return EXIT_FAILURE;
+    }
+
+    auto percentile(std::vector<uint64_t> & values, double fraction) -> double
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        const auto index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return static_cast<double>(values[index]) / 1e6;
+    }
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    if (argc < 2 || argc % 2 != 0)
+    {
+        return usage();
+    }
+
+    CaptureAnalyzer::Config config;
+    SimBootloader::Config bootloader;
+    std::vector<uint32_t> replays;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        const std::string key = argv[i];
+        const auto value      = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 0));
+
+        if (key == "--threads")
+        {
+            config.threads = value;
+        }
+        else if (key == "--replay")
+        {
+            replays.push_back(value);
+        }
+        else if (key == "--mtu")
+        {
+            bootloader.mtu = static_cast<uint16_t>(value);
+        }
+        else if (key == "--max-size")
+        {
+            bootloader.data_max_size = value;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    CaptureAnalyzer analyzer(config);
+    if (analyzer.open(argv[1]) != NRFDL_ERR_NONE)
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::map<DfuOpcode, OpcodeTable> tables;
+    if (analyzer.analyze(tables) != NRFDL_ERR_NONE)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("{} records, {} sessions, {} undecodable\n",
+               analyzer.records(),
+               analyzer.sessions().size(),
+               analyzer.decodeErrors());
+    fmt::print("{:>6} {:>10} {:>10} {:>8} {:>10} {:>10} {:>10}\n",
+               "opcode",
+               "requests",
+               "answered",
+               "failed",
+               "p50 ms",
+               "p99 ms",
+               "max ms");
+
+    for (const auto & [opcode, table] : tables)
+    {
+        std::vector<uint64_t> latencies;
+        size_t failed = 0;
+        for (size_t row = 0; row < table.rows(); row++)
+        {
+            if (table.latency[row] > 0)
+            {
+                latencies.push_back(table.latency[row]);
+            }
+            if (table.result[row] != DfuResult::NRF_DFU_RES_CODE_INVALID &&
+                table.result[row] != DfuResult::NRF_DFU_RES_CODE_SUCCESS)
+            {
+                failed++;
+            }
+        }
+
+        const auto answered = latencies.size();
+        const auto p50      = percentile(latencies, 0.5);
+        const auto p99      = percentile(latencies, 0.99);
+        const auto max      = percentile(latencies, 1.0);
+        fmt::print("{:#6x} {:>10} {:>10} {:>8} {:>10.3f} {:>10.3f} {:>10.3f}\n",
+                   static_cast<uint8_t>(opcode),
+                   table.rows(),
+                   answered,
+                   failed,
+                   p50,
+                   p99,
+                   max);
+    }
+
+    for (const auto session : replays)
+    {
+        SimBootloader device(bootloader);
+        ReplayResult result;
+        analyzer.replay(session, device, result);
+
+        if (result.mismatches == 0)
+        {
+            fmt::print("Session {}: {} requests match the simulated bootloader\n", session, result.requests);
+        }
+        else
+        {
+            fmt::print("Session {}: {} of {} responses differ, first at record {}\n",
+                       session,
+                       result.mismatches,
+                       result.responses,
+                       result.first_mismatch);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
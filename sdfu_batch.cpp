@@ -0,0 +1,177 @@
+#include "sdfu_batch.h"
+#include "sdfu_frames.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#if !defined(_WIN32)
+#include <climits>
+#include <unistd.h>
+#endif
+
+namespace NRFDL::SDFU
+{
+    FrameBatch::FrameBatch()
+        : _size(0)
+    {}
+
+    auto FrameBatch::clear() -> void
+    {
+        _buffer.clear();
+        _segments.clear();
+        _frameSizes.clear();
+        _iovecs.clear();
+        _size = 0;
+    }
+
+    auto FrameBatch::add(const DfuRequest & request) -> nrfdl_errorcode_t
+    {
+        const auto error = _codec.encode(request, _scratch);
+        if (error != NRFDL_ERR_NONE)
+        {
+            return error;
+        }
+
+        append(_scratch.data(), _scratch.size());
+        _frameSizes.push_back(_scratch.size());
+        return NRFDL_ERR_NONE;
+    }
+
+    auto FrameBatch::addWrite(const uint8_t * payload, uint16_t size) -> nrfdl_errorcode_t
+    {
+        if (payload == nullptr && size > 0)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        const auto trailer = Frames::writeTrailer(size);
+
+        append(Frames::writeHeader.data(), Frames::writeHeader.size());
+        if (size > 0)
+        {
+            _segments.push_back({payload, 0, size});
+            _size += size;
+        }
+        append(trailer.data(), trailer.size());
+
+        _frameSizes.push_back(size + Frames::writeOverhead);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto FrameBatch::addEncoded(const uint8_t * frame, size_t size) -> nrfdl_errorcode_t
+    {
+        if (frame == nullptr || size == 0)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        if (!_segments.empty() && _segments.back().external != nullptr &&
+            _segments.back().external + _segments.back().size == frame)
+        {
+            _segments.back().size += size;
+        }
+        else
+        {
+            _segments.push_back({frame, 0, size});
+        }
+
+        _size += size;
+        _frameSizes.push_back(size);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto FrameBatch::empty() const -> bool
+    {
+        return _frameSizes.empty();
+    }
+
+    auto FrameBatch::frames() const -> size_t
+    {
+        return _frameSizes.size();
+    }
+
+    auto FrameBatch::frameSizes() const -> const std::vector<size_t> &
+    {
+        return _frameSizes;
+    }
+
+    auto FrameBatch::size() const -> size_t
+    {
+        return _size;
+    }
+
+    auto FrameBatch::iovecs() -> const std::vector<iovec> &
+    {
+        // The buffer may have moved while it grew, so offsets are only resolved here
+        _iovecs.clear();
+        for (const auto & segment : _segments)
+        {
+            const auto base = segment.external ? segment.external : _buffer.data() + segment.offset;
+            _iovecs.push_back({const_cast<uint8_t *>(base), segment.size});
+        }
+        return _iovecs;
+    }
+
+#if !defined(_WIN32)
+    auto FrameBatch::writeTo(int fd, size_t & written) -> nrfdl_errorcode_t
+    {
+        // Consumed in place, the next call to iovecs() builds them again
+        iovecs();
+        auto & vectors = _iovecs;
+        size_t first   = 0;
+
+        // Skip what went out, a partial write leaves the rest of one entry
+        const auto advance = [&vectors, &first](size_t count) {
+            while (first < vectors.size() && count >= vectors[first].iov_len)
+            {
+                count -= vectors[first].iov_len;
+                first++;
+            }
+            if (count > 0 && first < vectors.size())
+            {
+                vectors[first].iov_base = static_cast<uint8_t *>(vectors[first].iov_base) + count;
+                vectors[first].iov_len -= count;
+            }
+        };
+        advance(written);
+
+        while (first < vectors.size())
+        {
+            const auto count  = static_cast<int>(std::min<size_t>(vectors.size() - first, IOV_MAX));
+            const auto result = ::writev(fd, &vectors[first], count);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    return NRFDL_ERR_NONE;
+                }
+                return (errno == EPIPE) ? NRFDL_ERR_CLOSED : NRFDL_ERR_GENERIC;
+            }
+
+            written += static_cast<size_t>(result);
+            advance(static_cast<size_t>(result));
+        }
+        return NRFDL_ERR_NONE;
+    }
+#endif
+
+    auto FrameBatch::append(const uint8_t * data, size_t size) -> void
+    {
+        if (!_segments.empty() && _segments.back().external == nullptr &&
+            _segments.back().offset + _segments.back().size == _buffer.size())
+        {
+            _segments.back().size += size;
+        }
+        else
+        {
+            _segments.push_back({nullptr, _buffer.size(), size});
+        }
+
+        _buffer.insert(_buffer.end(), data, data + size);
+        _size += size;
+    }
+} // namespace NRFDL::SDFU
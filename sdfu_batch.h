@@ -0,0 +1,98 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_codec.h"
+#include "sdfu_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_WIN32)
+struct iovec
+{
+    void * iov_base;
+    size_t iov_len;
+};
+#else
+#include <sys/uio.h>
+#endif
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Requests encoded back to back for a single gather write.
+     *
+     * Headers, trailers and small requests are appended to one buffer that is reused across batches. Write payloads
+     * added with @ref addWrite and requests added with @ref addEncoded are not copied: their iovec points into the
+     * caller's memory, which has to outlive the batch. The iovecs are built by @ref iovecs, adding requests
+     * afterwards invalidates them.
+     */
+    class FrameBatch
+    {
+      public:
+        FrameBatch();
+
+        auto clear() -> void;
+
+        auto add(const DfuRequest & request) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Append an @ref NRF_DFU_OP_OBJECT_WRITE request carrying @p size bytes at @p payload.
+         */
+        auto addWrite(const uint8_t * payload, uint16_t size) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Append a request encoded by the caller without copying it, e.g. a pre-encoded write of an
+         * @ref ObjectStore. Requests adjacent in memory share one iovec.
+         */
+        auto addEncoded(const uint8_t * frame, size_t size) -> nrfdl_errorcode_t;
+
+        auto empty() const -> bool;
+        /* Number of requests in the batch. */
+        auto frames() const -> size_t;
+        /* Encoded size of every request, in order. */
+        auto frameSizes() const -> const std::vector<size_t> &;
+        /* Encoded size of the whole batch. */
+        auto size() const -> size_t;
+
+        /**
+         * @brief Gather list of the batch, adjacent bytes in the buffer share one entry.
+         */
+        auto iovecs() -> const std::vector<iovec> &;
+
+#if !defined(_WIN32)
+        /**
+         * @brief Write the batch to @p fd with as few writev calls as IOV_MAX and partial writes allow.
+         *
+         * Writing starts after the first @p written bytes of the batch and adds what went out to @p written. On a
+         * blocking fd the call returns once the whole batch is written. A non-blocking fd that cannot take more ends
+         * the call early with @p written short of @ref size; call again with it once the fd is writable. The iovecs
+         * returned by @ref iovecs before are used up.
+         *
+         * @return NRFDL_ERR_CLOSED if the reader went away, NRFDL_ERR_GENERIC on other write errors. @p written
+         * counts the bytes written before the error.
+         */
+        auto writeTo(int fd, size_t & written) -> nrfdl_errorcode_t;
+#endif
+
+      private:
+        struct Segment
+        {
+            /* Caller owned bytes, nullptr if the segment is in the buffer. */
+            const uint8_t * external;
+            size_t offset;
+            size_t size;
+        };
+
+        auto append(const uint8_t * data, size_t size) -> void;
+
+        Codec _codec;
+        data_t _buffer;
+        data_t _scratch;
+        std::vector<Segment> _segments;
+        std::vector<size_t> _frameSizes;
+        std::vector<iovec> _iovecs;
+        size_t _size;
+    };
+} // namespace NRFDL::SDFU
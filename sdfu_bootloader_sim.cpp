@@ -0,0 +1,381 @@
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_crc32.h"
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        // This codec always carries the response details, even for failed requests
+        auto emptyResponse(DfuOpcode opcode) -> std::optional<DfuResponseType>
+        {
+            switch (opcode)
+            {
+                case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+                    return DfuResponseProtocol{};
+                case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                    return DfuResponseCreate{};
+                case DfuOpcode::NRF_DFU_OP_CRC_GET:
+                    return DfuResponseCrc{};
+                case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+                    return DfuResponseSelect{};
+                case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                    return DfuResponseMtu{};
+                case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                    return DfuResponseWrite{};
+                case DfuOpcode::NRF_DFU_OP_PING:
+                    return DfuResponsePing{};
+                case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION:
+                    return DfuResponseHardware{};
+                case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION:
+                    return DfuResponseFirmware{};
+                case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                case DfuOpcode::NRF_DFU_OP_ABORT:
+                case DfuOpcode::NRF_DFU_OP_RESPONSE:
+                case DfuOpcode::NRF_DFU_OP_INVALID:
+                    break;
+            }
+            return std::nullopt;
+        }
+
+        template <typename T> auto requestOf(const DfuRequest & request) -> const T *
+        {
+            return request.request ? std::get_if<T>(&*request.request) : nullptr;
+        }
+    } // namespace
+
+    SimBootloader::SimBootloader()
+        : SimBootloader(Config{})
+    {}
+
+    SimBootloader::SimBootloader(const Config & config)
+        : _config(config)
+        , _current(DfuObjecType::NRF_DFU_OBJ_TYPE_INVALID)
+        , _prnTarget(0)
+        , _prnCount(0)
+        , _commandEnd(0)
+        , _commandCrc(0)
+        , _dataEnd(0)
+        , _dataCrc(0)
+        , _dataExecuted(0)
+        , _dataCrcExecuted(0)
+    {}
+
+    auto SimBootloader::process(const data_t & packet, data_t & reply) -> nrfdl_errorcode_t
+    {
+        reply.clear();
+
+        DfuRequest request;
+        auto error = _codec.decode(packet, request);
+        if (error != NRFDL_ERR_NONE)
+        {
+            return error;
+        }
+
+        if (packet.size() > _config.mtu)
+        {
+            DfuResponse response;
+            response.opcode   = request.opcode;
+            response.result   = DfuResult::NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+            response.response = emptyResponse(request.opcode);
+            return _codec.encode(response, reply);
+        }
+
+        DfuResponse response;
+        if (process(request, response))
+        {
+            return _codec.encode(response, reply);
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto SimBootloader::process(const DfuRequest & request, DfuResponse & response) -> bool
+    {
+        response.opcode   = request.opcode;
+        response.result   = DfuResult::NRF_DFU_RES_CODE_SUCCESS;
+        response.response = emptyResponse(request.opcode);
+
+        switch (request.opcode)
+        {
+            case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+                response.response = DfuResponseProtocol{_config.protocol_version};
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                if (const auto create = requestOf<DfuRequestCreate>(request))
+                {
+                    this->create(*create, response);
+                }
+                else
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                }
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                if (const auto prn = requestOf<DfuRequestPrn>(request))
+                {
+                    _prnTarget = prn->target;
+                    _prnCount  = 0;
+                }
+                else
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                }
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_CRC_GET:
+                if (_current == DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND)
+                {
+                    response.response = DfuResponseCrc{static_cast<uint32_t>(_command.size()), _commandCrc};
+                }
+                else
+                {
+                    response.response = DfuResponseCrc{static_cast<uint32_t>(_data.size()), _dataCrc};
+                }
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                execute(response);
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+                if (const auto select = requestOf<DfuRequestSelect>(request))
+                {
+                    this->select(*select, response);
+                }
+                else
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                }
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                response.response = DfuResponseMtu{_config.mtu};
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                if (const auto write = requestOf<DfuRequestWrite>(request))
+                {
+                    return this->write(*write, response);
+                }
+                response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_PING:
+                if (const auto ping = requestOf<DfuRequestPing>(request))
+                {
+                    response.response = DfuResponsePing{ping->id};
+                }
+                else
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                }
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION:
+                response.response = _config.hardware;
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION:
+            {
+                const auto firmware = requestOf<DfuRequestFirmware>(request);
+                if (firmware != nullptr && firmware->image_number == 0)
+                {
+                    response.response = DfuResponseFirmware{
+                        DfuFirmwareType::NRF_DFU_FIRMWARE_TYPE_APPLICATION, 1, _config.app_addr, _dataExecuted};
+                }
+                else
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                }
+                break;
+            }
+
+            case DfuOpcode::NRF_DFU_OP_ABORT:
+                // Drop whatever was not executed yet, abort is not answered
+                _data.resize(_dataExecuted);
+                _dataCrc = _dataCrcExecuted;
+                _command.clear();
+                _current = DfuObjecType::NRF_DFU_OBJ_TYPE_INVALID;
+                return false;
+
+            case DfuOpcode::NRF_DFU_OP_RESPONSE:
+            case DfuOpcode::NRF_DFU_OP_INVALID:
+            default:
+                response.result = DfuResult::NRF_DFU_RES_CODE_OP_CODE_NOT_SUPPORTED;
+                break;
+        }
+
+        return true;
+    }
+
+    auto SimBootloader::command() const -> const data_t &
+    {
+        return _commandExecuted;
+    }
+
+    auto SimBootloader::firmware() const -> const data_t &
+    {
+        return _data;
+    }
+
+    auto SimBootloader::executedSize() const -> uint32_t
+    {
+        return _dataExecuted;
+    }
+
+    auto SimBootloader::create(const DfuRequestCreate & request, DfuResponse & response) -> void
+    {
+        switch (static_cast<DfuObjecType>(request.object_type))
+        {
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND:
+                if (request.object_size == 0 || request.object_size > _config.command_max_size)
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+                    return;
+                }
+                _command.clear();
+                _commandEnd       = request.object_size;
+                _commandCrc       = 0;
+                _current          = DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND;
+                response.response = DfuResponseCreate{0, 0};
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_DATA:
+                if (_commandExecuted.empty())
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+                    return;
+                }
+                if (request.object_size == 0 || request.object_size > _config.data_max_size)
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+                    return;
+                }
+                // Restart from the last executed object
+                _data.resize(_dataExecuted);
+                _dataCrc          = _dataCrcExecuted;
+                _dataEnd          = _dataExecuted + request.object_size;
+                _current          = DfuObjecType::NRF_DFU_OBJ_TYPE_DATA;
+                response.response = DfuResponseCreate{_dataExecuted, _dataCrc};
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_INVALID:
+            default:
+                response.result = DfuResult::NRF_DFU_RES_CODE_UNSUPPORTED_TYPE;
+                return;
+        }
+
+        _prnCount = 0;
+    }
+
+    auto SimBootloader::write(const DfuRequestWrite & request, DfuResponse & response) -> bool
+    {
+        const auto size = request.data.size();
+
+        switch (_current)
+        {
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND:
+                if (_command.size() + size > _commandEnd)
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                    return true;
+                }
+                _command.insert(_command.end(), request.data.begin(), request.data.end());
+                _commandCrc       = crc32(request.data.data(), size, _commandCrc);
+                response.response = DfuResponseWrite{static_cast<uint32_t>(_command.size()), _commandCrc};
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_DATA:
+                if (_data.size() + size > _dataEnd)
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_INVALID_PARAMETER;
+                    return true;
+                }
+                _data.insert(_data.end(), request.data.begin(), request.data.end());
+                _dataCrc          = crc32(request.data.data(), size, _dataCrc);
+                response.response = DfuResponseWrite{static_cast<uint32_t>(_data.size()), _dataCrc};
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_INVALID:
+            default:
+                response.result = DfuResult::NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+                return true;
+        }
+
+        if (_prnTarget > 0 && ++_prnCount == _prnTarget)
+        {
+            _prnCount = 0;
+            return true;
+        }
+        return false;
+    }
+
+    auto SimBootloader::execute(DfuResponse & response) -> void
+    {
+        switch (_current)
+        {
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND:
+                if (_command.empty() || _command.size() != _commandEnd)
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+                    return;
+                }
+                if (_command != _commandExecuted)
+                {
+                    // A different init packet starts a new firmware transfer
+                    _data.clear();
+                    _dataCrc         = 0;
+                    _dataExecuted    = 0;
+                    _dataCrcExecuted = 0;
+                    _dataEnd         = 0;
+                    _commandExecuted = _command;
+                }
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_DATA:
+                if (_data.size() == _dataExecuted)
+                {
+                    // Nothing pending, the object was executed before
+                    break;
+                }
+                if (_data.size() != _dataEnd)
+                {
+                    response.result = DfuResult::NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+                    return;
+                }
+                _dataExecuted    = static_cast<uint32_t>(_data.size());
+                _dataCrcExecuted = _dataCrc;
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_INVALID:
+            default:
+                response.result = DfuResult::NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+                break;
+        }
+    }
+
+    auto SimBootloader::select(const DfuRequestSelect & request, DfuResponse & response) -> void
+    {
+        switch (static_cast<DfuObjecType>(request.object_type))
+        {
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND:
+                _current          = DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND;
+                response.response = DfuResponseSelect{
+                    static_cast<uint32_t>(_command.size()), _commandCrc, _config.command_max_size};
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_DATA:
+                _current = DfuObjecType::NRF_DFU_OBJ_TYPE_DATA;
+                response.response =
+                    DfuResponseSelect{static_cast<uint32_t>(_data.size()), _dataCrc, _config.data_max_size};
+                break;
+
+            case DfuObjecType::NRF_DFU_OBJ_TYPE_INVALID:
+            default:
+                response.result = DfuResult::NRF_DFU_RES_CODE_UNSUPPORTED_TYPE;
+                break;
+        }
+    }
+} // namespace NRFDL::SDFU
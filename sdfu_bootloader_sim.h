@@ -0,0 +1,80 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_codec.h"
+#include "sdfu_types.h"
+
+#include <cstdint>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief In-process model of the Secure DFU bootloader object handling.
+     *
+     * Follows the nRF5 SDK request handler closely enough to exercise a @ref Session: objects are created, written,
+     * CRC checked and executed, receipts are sent every PRN writes and creating a data object discards anything
+     * written after the last executed object. Executing an init packet that differs from the previous one restarts
+     * the firmware transfer. No signature or init packet validation is done.
+     */
+    class SimBootloader
+    {
+      public:
+        struct Config
+        {
+            /* Largest request frame accepted, reported through NRF_DFU_OP_MTU_GET. */
+            uint16_t mtu = 1024;
+            uint32_t command_max_size = 512;
+            uint32_t data_max_size    = 4096;
+            uint8_t protocol_version  = 1;
+            uint32_t app_addr         = 0x1000;
+            DfuResponseHardware hardware{0x52840, 0x41414430, {0x100000, 0x40000, 0x1000}};
+        };
+
+        SimBootloader();
+        explicit SimBootloader(const Config & config);
+
+        /**
+         * @brief Handle one request frame.
+         *
+         * @param response Encoded response, empty if the bootloader does not answer the request.
+         */
+        auto process(const data_t & request, data_t & response) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Handle one decoded request.
+         *
+         * @return true if the bootloader answers the request.
+         */
+        auto process(const DfuRequest & request, DfuResponse & response) -> bool;
+
+        /* Init packet of the last executed command object. */
+        auto command() const -> const data_t &;
+        /* Firmware received so far, including data not executed yet. */
+        auto firmware() const -> const data_t &;
+        auto executedSize() const -> uint32_t;
+
+      private:
+        auto create(const DfuRequestCreate & request, DfuResponse & response) -> void;
+        auto write(const DfuRequestWrite & request, DfuResponse & response) -> bool;
+        auto execute(DfuResponse & response) -> void;
+        auto select(const DfuRequestSelect & request, DfuResponse & response) -> void;
+
+        Config _config;
+        Codec _codec;
+
+        DfuObjecType _current;
+        uint32_t _prnTarget;
+        uint32_t _prnCount;
+
+        data_t _command;
+        data_t _commandExecuted;
+        uint32_t _commandEnd;
+        uint32_t _commandCrc;
+
+        data_t _data;
+        uint32_t _dataEnd;
+        uint32_t _dataCrc;
+        uint32_t _dataExecuted;
+        uint32_t _dataCrcExecuted;
+    };
+} // namespace NRFDL::SDFU
@@ -0,0 +1,502 @@
+#include "sdfu_capture.h"
+#include "sdfu_frames.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        constexpr char magic[8]     = {'S', 'D', 'F', 'U', 'C', 'A', 'P', '1'};
+        constexpr size_t headerSize = 16;
+        /* Buffered bytes that trigger a write to the file. */
+        constexpr size_t flushSize = 64 * 1024;
+
+        auto put(data_t & out, uint64_t value, size_t bytes) -> void
+        {
+            for (size_t i = 0; i < bytes; i++)
+            {
+                out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+            }
+        }
+
+        auto get(const uint8_t * in, size_t bytes) -> uint64_t
+        {
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; i++)
+            {
+                value |= static_cast<uint64_t>(in[i]) << (8 * i);
+            }
+            return value;
+        }
+
+        /**
+         * @brief Decoded fields of one frame, small enough to keep one per record.
+         */
+        struct Event
+        {
+            DfuOpcode opcode = DfuOpcode::NRF_DFU_OP_INVALID;
+            DfuResult result = DfuResult::NRF_DFU_RES_CODE_INVALID;
+            uint32_t offset  = 0;
+            uint32_t crc     = 0;
+            uint32_t size    = 0;
+        };
+
+        auto eventOf(const DfuRequest & request) -> Event
+        {
+            Event event;
+            event.opcode = request.opcode;
+
+            if (request.request)
+            {
+                if (const auto create = std::get_if<DfuRequestCreate>(&*request.request))
+                {
+                    event.size = create->object_size;
+                }
+                else if (const auto write = std::get_if<DfuRequestWrite>(&*request.request))
+                {
+                    event.size = static_cast<uint32_t>(write->data.size());
+                }
+            }
+            return event;
+        }
+
+        auto eventOf(const DfuResponse & response) -> Event
+        {
+            Event event;
+            event.opcode = response.opcode;
+            event.result = response.result;
+
+            if (response.response)
+            {
+                std::visit(
+                    [&event](const auto & details) {
+                        using T = std::decay_t<decltype(details)>;
+                        if constexpr (std::is_same_v<T, DfuResponseSelect> || std::is_same_v<T, DfuResponseCreate> ||
+                                      std::is_same_v<T, DfuResponseWrite> || std::is_same_v<T, DfuResponseCrc>)
+                        {
+                            event.offset = details.offset;
+                            event.crc    = details.crc;
+                        }
+                    },
+                    *response.response);
+            }
+            return event;
+        }
+
+        // Writes are most of the traffic and only their size is of interest, skip decoding and copying the payload
+        auto writeEvent(const uint8_t * frame, size_t length, Event & event) -> bool
+        {
+            if (length < Frames::writeOverhead || frame[0] != Frames::writeHeader[0] ||
+                get(frame + length - 2, 2) != length - Frames::writeOverhead)
+            {
+                return false;
+            }
+
+            event.opcode = DfuOpcode::NRF_DFU_OP_OBJECT_WRITE;
+            event.size   = static_cast<uint32_t>(length - Frames::writeOverhead);
+            return true;
+        }
+
+        auto pendingKey(uint32_t session, DfuOpcode opcode) -> uint64_t
+        {
+            return (static_cast<uint64_t>(session) << 8) | static_cast<uint8_t>(opcode);
+        }
+    } // namespace
+
+    CaptureWriter::CaptureWriter()
+        : _file(nullptr)
+    {
+        _logger = spdlog::default_logger();
+    }
+
+    CaptureWriter::~CaptureWriter()
+    {
+        close();
+    }
+
+    auto CaptureWriter::open(const std::string & path, Clock::time_point now) -> nrfdl_errorcode_t
+    {
+        close();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _file = std::fopen(path.c_str(), "wb");
+        if (_file == nullptr)
+        {
+            _logger->error("Cannot open capture {}.", path);
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        _start = now;
+        _buffer.assign(std::begin(magic), std::end(magic));
+        _buffer.reserve(flushSize + headerSize + UINT16_MAX);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto CaptureWriter::record(uint32_t session,
+                               CaptureDirection direction,
+                               const data_t & frame,
+                               Clock::time_point now) -> nrfdl_errorcode_t
+    {
+        if (frame.size() > UINT16_MAX)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_file == nullptr)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _start).count();
+
+        put(_buffer, static_cast<uint64_t>(std::max<int64_t>(time, 0)), 8);
+        put(_buffer, session, 4);
+        put(_buffer, frame.size(), 2);
+        put(_buffer, static_cast<uint8_t>(direction), 1);
+        put(_buffer, 0, 1);
+        _buffer.insert(_buffer.end(), frame.begin(), frame.end());
+
+        return (_buffer.size() >= flushSize) ? write() : NRFDL_ERR_NONE;
+    }
+
+    auto CaptureWriter::flush() -> nrfdl_errorcode_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_file == nullptr)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        const auto error = write();
+        return (error == NRFDL_ERR_NONE && std::fflush(_file) != 0) ? NRFDL_ERR_GENERIC : error;
+    }
+
+    auto CaptureWriter::close() -> nrfdl_errorcode_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_file == nullptr)
+        {
+            return NRFDL_ERR_NONE;
+        }
+
+        auto error = write();
+        if (std::fclose(_file) != 0)
+        {
+            error = NRFDL_ERR_GENERIC;
+        }
+        _file = nullptr;
+        return error;
+    }
+
+    auto CaptureWriter::write() -> nrfdl_errorcode_t
+    {
+        const auto written = std::fwrite(_buffer.data(), 1, _buffer.size(), _file);
+        const auto full    = written == _buffer.size();
+        _buffer.clear();
+
+        if (!full)
+        {
+            _logger->error("Capture write failed.");
+            return NRFDL_ERR_GENERIC;
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto OpcodeTable::rows() const -> size_t
+    {
+        return time.size();
+    }
+
+    CaptureAnalyzer::CaptureAnalyzer()
+        : CaptureAnalyzer(Config{})
+    {}
+
+    CaptureAnalyzer::CaptureAnalyzer(const Config & config)
+        : _config(config)
+        , _decodeErrors(0)
+    {
+        _logger = spdlog::default_logger();
+    }
+
+    auto CaptureAnalyzer::open(const std::string & path) -> nrfdl_errorcode_t
+    {
+        _offsets.clear();
+        _file = std::make_unique<MappedFile>(path);
+
+        if (!_file->ok() || _file->size() < sizeof(magic) || std::memcmp(_file->data(), magic, sizeof(magic)) != 0)
+        {
+            _logger->error("{} is not a DFU capture.", path);
+            _file.reset();
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        // Only the headers are touched, the frames are skipped
+        const auto data = reinterpret_cast<const uint8_t *>(_file->data());
+        const auto size = _file->size();
+
+        size_t offset = sizeof(magic);
+        while (size - offset >= headerSize)
+        {
+            const auto length = static_cast<size_t>(get(data + offset + 12, 2));
+            if (size - offset - headerSize < length)
+            {
+                break;
+            }
+            _offsets.push_back(offset);
+            offset += headerSize + length;
+        }
+
+        if (offset != size)
+        {
+            _logger->warn("Capture {} ends with a truncated record at {}.", path, offset);
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto CaptureAnalyzer::records() const -> size_t
+    {
+        return _offsets.size();
+    }
+
+    auto CaptureAnalyzer::sessions() const -> std::vector<uint32_t>
+    {
+        std::set<uint32_t> sessions;
+        for (size_t i = 0; i < _offsets.size(); i++)
+        {
+            sessions.insert(record(i).session);
+        }
+        return {sessions.begin(), sessions.end()};
+    }
+
+    auto CaptureAnalyzer::decodeErrors() const -> uint64_t
+    {
+        return _decodeErrors;
+    }
+
+    auto CaptureAnalyzer::analyze(std::map<DfuOpcode, OpcodeTable> & tables) -> nrfdl_errorcode_t
+    {
+        if (!_file)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        tables.clear();
+
+        const auto count = _offsets.size();
+        std::vector<Event> events(count);
+        std::vector<uint64_t> errors;
+
+        // Decode contiguous ranges of records in parallel, every thread fills its own slice of events
+        auto threads = _config.threads ? _config.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads      = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threads, count / 1024 + 1)));
+        errors.assign(threads, 0);
+
+        const auto decode = [this, &events, &errors, count, threads](uint32_t worker) {
+            const auto begin = count * worker / threads;
+            const auto end   = count * (worker + 1) / threads;
+
+            Codec codec;
+            data_t frame;
+            DfuRequest request;
+            DfuResponse response;
+
+            for (auto i = begin; i < end; i++)
+            {
+                const auto r = record(i);
+                if (r.direction == CaptureDirection::HostToDevice && writeEvent(r.frame, r.length, events[i]))
+                {
+                    continue;
+                }
+                frame.assign(r.frame, r.frame + r.length);
+
+                if (r.direction == CaptureDirection::HostToDevice)
+                {
+                    if (codec.decode(frame, request) == NRFDL_ERR_NONE)
+                    {
+                        events[i] = eventOf(request);
+                        continue;
+                    }
+                }
+                else if (codec.decode(frame, response) == NRFDL_ERR_NONE)
+                {
+                    events[i] = eventOf(response);
+                    continue;
+                }
+                errors[worker]++;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (uint32_t worker = 1; worker < threads; worker++)
+        {
+            workers.emplace_back(decode, worker);
+        }
+        decode(0);
+        for (auto & worker : workers)
+        {
+            worker.join();
+        }
+
+        _decodeErrors = 0;
+        for (auto e : errors)
+        {
+            _decodeErrors += e;
+        }
+        if (_decodeErrors > 0)
+        {
+            _logger->warn("{} capture records could not be decoded.", _decodeErrors);
+        }
+
+        // Match responses with the latest unanswered request of the same opcode in the session, write receipts
+        // answer the last write before them
+        struct Pending
+        {
+            OpcodeTable * table;
+            size_t row;
+        };
+        std::unordered_map<uint64_t, Pending> pending;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto & event = events[i];
+            if (event.opcode == DfuOpcode::NRF_DFU_OP_INVALID)
+            {
+                continue;
+            }
+
+            const auto r   = record(i);
+            const auto key = pendingKey(r.session, event.opcode);
+
+            if (r.direction == CaptureDirection::HostToDevice)
+            {
+                auto & table = tables[event.opcode];
+                table.time.push_back(r.time);
+                table.session.push_back(r.session);
+                table.latency.push_back(0);
+                table.result.push_back(DfuResult::NRF_DFU_RES_CODE_INVALID);
+                table.offset.push_back(0);
+                table.crc.push_back(0);
+                table.size.push_back(event.size);
+                pending[key] = {&table, table.rows() - 1};
+                continue;
+            }
+
+            const auto match = pending.find(key);
+            if (match == pending.end())
+            {
+                continue;
+            }
+
+            auto & table       = *match->second.table;
+            const auto row     = match->second.row;
+            table.latency[row] = std::max<uint64_t>(r.time - table.time[row], 1);
+            table.result[row]  = event.result;
+            table.offset[row]  = event.offset;
+            table.crc[row]     = event.crc;
+            pending.erase(match);
+        }
+
+        return NRFDL_ERR_NONE;
+    }
+
+    auto CaptureAnalyzer::replay(uint32_t session, SimBootloader & device, ReplayResult & result) -> nrfdl_errorcode_t
+    {
+        if (!_file)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        result = ReplayResult{};
+
+        Codec codec;
+        data_t frame;
+        DfuRequest request;
+        DfuResponse captured;
+        DfuResponse simulated;
+        data_t encoded;
+        std::deque<data_t> expected;
+
+        const auto mismatch = [&result](size_t index) {
+            result.mismatches++;
+            result.first_mismatch = std::min(result.first_mismatch, index);
+        };
+
+        for (size_t i = 0; i < _offsets.size(); i++)
+        {
+            const auto r = record(i);
+            if (r.session != session)
+            {
+                continue;
+            }
+
+            frame.assign(r.frame, r.frame + r.length);
+            if (r.direction == CaptureDirection::HostToDevice)
+            {
+                if (codec.decode(frame, request) != NRFDL_ERR_NONE)
+                {
+                    continue;
+                }
+
+                result.requests++;
+                if (device.process(request, simulated))
+                {
+                    expected.emplace_back();
+                    if (codec.encode(simulated, expected.back()) != NRFDL_ERR_NONE)
+                    {
+                        expected.back().clear();
+                    }
+                }
+                continue;
+            }
+
+            if (codec.decode(frame, captured) != NRFDL_ERR_NONE)
+            {
+                continue;
+            }
+
+            result.responses++;
+            if (expected.empty())
+            {
+                mismatch(i);
+                continue;
+            }
+
+            // Compare the encodings of both responses, so every detail counts, e.g. the object size or the MTU
+            if (codec.encode(captured, encoded) != NRFDL_ERR_NONE || encoded != expected.front())
+            {
+                mismatch(i);
+            }
+            expected.pop_front();
+        }
+
+        if (result.mismatches > 0)
+        {
+            _logger->info("Session {} diverges from the simulation at record {}.", session, result.first_mismatch);
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto CaptureAnalyzer::record(size_t index) const -> Record
+    {
+        const auto header = reinterpret_cast<const uint8_t *>(_file->data()) + _offsets[index];
+
+        Record r;
+        r.time      = get(header, 8);
+        r.session   = static_cast<uint32_t>(get(header + 8, 4));
+        r.length    = static_cast<uint16_t>(get(header + 12, 2));
+        r.direction = static_cast<CaptureDirection>(header[14]);
+        r.frame     = header + headerSize;
+        return r;
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_codec.h"
+#include "sdfu_mapped_file.h"
+#include "sdfu_types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace NRFDL::SDFU
+{
+    enum class CaptureDirection : uint8_t
+    {
+        HostToDevice = 0,
+        DeviceToHost = 1,
+    };
+
+    /**
+     * @brief Writer of DFU traffic captures.
+     *
+     * A capture is an 8 byte magic followed by one record per frame: a 16 byte little endian header holding the time
+     * since the capture was opened in nanoseconds, the session, the frame length and the direction, then the frame as
+     * passed to or returned from @ref Codec. Transports of several devices may share one writer.
+     */
+    class CaptureWriter
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        CaptureWriter();
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter &) = delete;
+        auto operator=(const CaptureWriter &) -> CaptureWriter & = delete;
+
+        auto open(const std::string & path, Clock::time_point now = Clock::now()) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Append one frame. Records are buffered, see @ref flush.
+         */
+        auto record(uint32_t session,
+                    CaptureDirection direction,
+                    const data_t & frame,
+                    Clock::time_point now = Clock::now()) -> nrfdl_errorcode_t;
+
+        auto flush() -> nrfdl_errorcode_t;
+        auto close() -> nrfdl_errorcode_t;
+
+      private:
+        auto write() -> nrfdl_errorcode_t;
+
+        std::FILE * _file;
+        Clock::time_point _start;
+        data_t _buffer;
+        std::mutex _mutex;
+        std::shared_ptr<spdlog::logger> _logger;
+    };
+
+    /**
+     * @brief Requests of one opcode found in a capture, stored column wise. Row i of every column is the same request.
+     */
+    struct OpcodeTable
+    {
+        /* Nanoseconds from the start of the capture to the request. */
+        std::vector<uint64_t> time;
+        std::vector<uint32_t> session;
+        /* Nanoseconds until the response, 0 if the request was not answered. */
+        std::vector<uint64_t> latency;
+        /* NRF_DFU_RES_CODE_INVALID if the request was not answered. */
+        std::vector<DfuResult> result;
+        /* Offset and CRC of select, create, write receipt and CRC responses. */
+        std::vector<uint32_t> offset;
+        std::vector<uint32_t> crc;
+        /* Object size of a create request, payload size of a write request. */
+        std::vector<uint32_t> size;
+
+        auto rows() const -> size_t;
+    };
+
+    /**
+     * @brief Outcome of replaying a captured session against a @ref SimBootloader.
+     */
+    struct ReplayResult
+    {
+        uint64_t requests  = 0;
+        uint64_t responses = 0;
+        /* Captured responses that differ from the simulated ones or have no simulated counterpart. */
+        uint64_t mismatches = 0;
+        /* Record index of the first mismatching response, SIZE_MAX if there is none. */
+        size_t first_mismatch = SIZE_MAX;
+    };
+
+    /**
+     * @brief Offline analysis of captures written by @ref CaptureWriter.
+     *
+     * The capture is memory mapped and its record boundaries are indexed by walking the record headers. The frames
+     * are then decoded in parallel, each thread taking a contiguous range of records, and requests are matched with
+     * their responses in a final sequential pass over the decoded records.
+     */
+    class CaptureAnalyzer
+    {
+      public:
+        struct Config
+        {
+            /* Decoding threads, 0 uses one per core. */
+            uint32_t threads = 0;
+        };
+
+        CaptureAnalyzer();
+        explicit CaptureAnalyzer(const Config & config);
+
+        /**
+         * @brief Map and index a capture.
+         *
+         * @return NRFDL_ERR_ARGUMENT if the file cannot be mapped or is not a capture. A truncated last record is
+         * dropped with a warning.
+         */
+        auto open(const std::string & path) -> nrfdl_errorcode_t;
+
+        auto records() const -> size_t;
+        auto sessions() const -> std::vector<uint32_t>;
+        /* Frames that failed to decode in the last @ref analyze. */
+        auto decodeErrors() const -> uint64_t;
+
+        auto analyze(std::map<DfuOpcode, OpcodeTable> & tables) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Send the captured requests of a session to a simulated bootloader and compare the responses.
+         */
+        auto replay(uint32_t session, SimBootloader & device, ReplayResult & result) -> nrfdl_errorcode_t;
+
+      private:
+        struct Record
+        {
+            uint64_t time;
+            uint32_t session;
+            uint16_t length;
+            CaptureDirection direction;
+            const uint8_t * frame;
+        };
+
+        auto record(size_t index) const -> Record;
+
+        Config _config;
+        std::unique_ptr<MappedFile> _file;
+        std::vector<size_t> _offsets;
+        uint64_t _decodeErrors;
+        std::shared_ptr<spdlog::logger> _logger;
+    };
+} // namespace NRFDL::SDFU
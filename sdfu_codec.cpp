@@ -2,6 +2,7 @@
 #include "nrfdl_types.h"
 
 #include "sdfu_codec_bitsery.h"
+#include "sdfu_frames.h"
 
 #include <bitsery/bitsery.h>
 
@@ -18,13 +19,103 @@ namespace NRFDL::SDFU
         static constexpr bool CheckDataErrors               = true;
     };
 
+    namespace
+    {
+        template <typename T> auto argument(const DfuRequest & request) -> const T *
+        {
+            return request.request ? std::get_if<T>(&*request.request) : nullptr;
+        }
+
+        template <size_t N> auto assign(data_t & packet, const Frames::Frame<N> & frame) -> bool
+        {
+            packet.assign(frame.begin(), frame.end());
+            return true;
+        }
+
+        // Requests with fixed size arguments are copied from a prebuilt frame instead of going through bitsery
+        auto encodeFixed(const DfuRequest & request, data_t & packet) -> bool
+        {
+            switch (request.opcode)
+            {
+                case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+                    return assign(packet, Frames::protocolVersion);
+                case DfuOpcode::NRF_DFU_OP_CRC_GET:
+                    return assign(packet, Frames::crcGet);
+                case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                    return assign(packet, Frames::objectExecute);
+                case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION:
+                    return assign(packet, Frames::hardwareVersion);
+                case DfuOpcode::NRF_DFU_OP_ABORT:
+                    return assign(packet, Frames::abortDfu);
+
+                case DfuOpcode::NRF_DFU_OP_PING:
+                    if (const auto ping = argument<DfuRequestPing>(request))
+                    {
+                        return assign(packet, Frames::ping(ping->id));
+                    }
+                    break;
+
+                case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION:
+                    if (const auto firmware = argument<DfuRequestFirmware>(request))
+                    {
+                        return assign(packet, Frames::firmwareVersion(firmware->image_number));
+                    }
+                    break;
+
+                case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                    if (const auto mtu = argument<DfuRequestMtu>(request))
+                    {
+                        return assign(packet, Frames::mtuGet(mtu->size));
+                    }
+                    break;
+
+                case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                    if (const auto prn = argument<DfuRequestPrn>(request))
+                    {
+                        return assign(packet, Frames::receiptNotifSet(prn->target));
+                    }
+                    break;
+
+                case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+                    if (const auto select = argument<DfuRequestSelect>(request))
+                    {
+                        return assign(packet, Frames::objectSelect(select->object_type));
+                    }
+                    break;
+
+                case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                    if (const auto create = argument<DfuRequestCreate>(request))
+                    {
+                        return assign(packet, Frames::objectCreate(create->object_type, create->object_size));
+                    }
+                    break;
+
+                case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                case DfuOpcode::NRF_DFU_OP_RESPONSE:
+                case DfuOpcode::NRF_DFU_OP_INVALID:
+                    break;
+            }
+            return false;
+        }
+    } // namespace
+
     Codec::Codec()
+        : Codec(std::pmr::get_default_resource())
+    {}
+
+    Codec::Codec(std::pmr::memory_resource * memory)
+        : _memory(memory)
     {
         _logger = spdlog::default_logger();
     }
 
     auto Codec::encode(const DfuRequest & request, data_t & packet) -> nrfdl_errorcode_t
     {
+        if (encodeFixed(request, packet))
+        {
+            return NRFDL_ERR_NONE;
+        }
+
         using OutputAdapter = bitsery::OutputBufferAdapter<data_t, BitseryConfig>;
         auto writtenSize    = bitsery::quickSerialization<OutputAdapter>(packet, request);
         packet.resize(writtenSize);
@@ -45,4 +136,52 @@ namespace NRFDL::SDFU
 
         return NRFDL_ERR_NONE;
     }
+
+    auto Codec::encode(const DfuResponse & response, data_t & packet) -> nrfdl_errorcode_t
+    {
+        using OutputAdapter = bitsery::OutputBufferAdapter<data_t, BitseryConfig>;
+        auto writtenSize    = bitsery::quickSerialization<OutputAdapter>(packet, response);
+        packet.resize(writtenSize);
+        _logger->debug("Encoded response into {} bytes.", writtenSize);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Codec::decode(const data_t & packet, DfuRequest & request) -> nrfdl_errorcode_t
+    {
+        using InputAdapter = bitsery::InputBufferAdapter<data_t, BitseryConfig>;
+
+        if (!packet.empty() && packet[0] == static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_OBJECT_WRITE))
+        {
+            // Write payload runs up to the trailing 16 bit length, see DfuRequestWriteExt
+            if (packet.size() < Frames::writeOverhead)
+            {
+                _logger->error("Error parsing request");
+                return NRFDL_ERR_PROTOCOL;
+            }
+
+            DfuRequestWrite write(_memory);
+            write.data.assign(packet.begin() + 1, packet.end() - 2);
+            write.len = static_cast<uint16_t>(packet[packet.size() - 2] | (packet[packet.size() - 1] << 8));
+            if (write.len != write.data.size())
+            {
+                _logger->error("Error parsing request, length {} does not match payload {}",
+                               write.len,
+                               write.data.size());
+                return NRFDL_ERR_PROTOCOL;
+            }
+
+            request.opcode  = DfuOpcode::NRF_DFU_OP_OBJECT_WRITE;
+            request.request = std::move(write);
+            return NRFDL_ERR_NONE;
+        }
+
+        auto state = bitsery::quickDeserialization<InputAdapter>({packet.begin(), packet.size()}, request);
+        if (!(state.first == bitsery::ReaderError::NoError && state.second))
+        {
+            _logger->error("Error parsing request");
+            return NRFDL_ERR_PROTOCOL;
+        }
+
+        return NRFDL_ERR_NONE;
+    }
 } // namespace NRFDL::SDFU
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 using data_t = std::vector<uint8_t>;
@@ -8,6 +9,7 @@ using data_t = std::vector<uint8_t>;
 #include "sdfu_types.h"
 
 #include <memory>
+#include <memory_resource>
 
 #include <spdlog/spdlog.h>
 
@@ -17,11 +19,20 @@ namespace NRFDL::SDFU
     {
       public:
         Codec();
+        /**
+         * @param memory Resource for the payload of decoded @ref NRF_DFU_OP_OBJECT_WRITE requests.
+         */
+        explicit Codec(std::pmr::memory_resource * memory);
 
         auto encode(const DfuRequest & request, data_t & data) -> nrfdl_errorcode_t;
         auto decode(const data_t & data, DfuResponse & response) -> nrfdl_errorcode_t;
 
+        /* Bootloader side of the protocol, used by the simulated bootloader and traffic analysis. */
+        auto encode(const DfuResponse & response, data_t & data) -> nrfdl_errorcode_t;
+        auto decode(const data_t & data, DfuRequest & request) -> nrfdl_errorcode_t;
+
       private:
+        std::pmr::memory_resource * _memory;
         std::shared_ptr<spdlog::logger> _logger;
     };
 } // namespace NRFDL::SDFU
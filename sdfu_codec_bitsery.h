@@ -8,117 +8,6 @@
 
 using namespace NRFDL::SDFU;
 
-namespace NRFDL::SDFU
-{
-    template <typename S> void serialize(S & s, DfuResponseProtocol & o)
-    {
-        s.value1b(o.version);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseHardware & o)
-    {
-        s.value4b(o.part);
-        s.value4b(o.variant);
-        s.object(o.memory);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseHardwareMemory & o)
-    {
-        s.value4b(o.rom_size);
-        s.value4b(o.ram_size);
-        s.value4b(o.rom_page_size);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseFirmware & o)
-    {
-        s.value1b(o.type);
-        s.value4b(o.version);
-        s.value4b(o.addr);
-        s.value4b(o.len);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseSelect & o)
-    {
-        s.value4b(o.offset);
-        s.value4b(o.crc);
-        s.value4b(o.max_size);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseCreate & o)
-    {
-        s.value4b(o.offset);
-        s.value4b(o.crc);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseWrite & o)
-    {
-        s.value4b(o.offset);
-        s.value4b(o.crc);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseCrc & o)
-    {
-        s.value4b(o.offset);
-        s.value4b(o.crc);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponsePing & o)
-    {
-        s.value1b(o.id);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponseMtu & o)
-    {
-        s.value2b(o.size);
-    };
-
-    template <typename S> void serialize(S & s, DfuResponse & obj)
-    {
-        s.ext(obj, bitsery::ext::DfuResponseExt{});
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestFirmware & o)
-    {
-        s.value1b(o.image_number);
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestSelect & o)
-    {
-        s.value4b(o.object_type);
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestCreate & o)
-    {
-        s.value4b(o.object_type);
-        s.value4b(o.object_size);
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestWrite & o)
-    {
-        s.ext(o, bitsery::ext::DfuRequestWriteExt{});
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestPing & o)
-    {
-        s.value1b(o.id);
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestMtu & o)
-    {
-        s.value2b(o.size);
-    };
-
-    template <typename S> void serialize(S & s, DfuRequestPrn & o)
-    {
-        s.value4b(o.target);
-    };
-
-    template <typename S> void serialize(S & s, DfuRequest & o)
-    {
-        s.ext(o, bitsery::ext::DfuRequestExt{});
-    }
-} // namespace NRFDL::SDFU
-
 namespace bitsery
 {
     namespace ext
@@ -208,11 +97,55 @@ namespace bitsery
                 }
             }
 
-            // template <typename Des, typename T, typename Fnc> void deserialize(Des & des, T & obj, Fnc && fnc) const
-            template <typename Des, typename T, typename Fnc> void deserialize(Des & s, T & obj, Fnc && fnc) const
+            template <typename Des, typename T, typename Fnc> void deserialize(Des & des, T & obj, Fnc && fnc) const
             {
-                T res{};
-                fnc(s, res);
+                des.value1b(obj.opcode);
+                obj.request.reset();
+
+                switch (obj.opcode)
+                {
+                    case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION:
+                        obj.request = DfuRequestFirmware{};
+                        des.object(std::get<DfuRequestFirmware>(*obj.request));
+                        break;
+
+                    case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                        obj.request = DfuRequestCreate{};
+                        des.object(std::get<DfuRequestCreate>(*obj.request));
+                        break;
+
+                    case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                        obj.request = DfuRequestPrn{};
+                        des.object(std::get<DfuRequestPrn>(*obj.request));
+                        break;
+
+                    case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+                        obj.request = DfuRequestSelect{};
+                        des.object(std::get<DfuRequestSelect>(*obj.request));
+                        break;
+
+                    case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                        obj.request = DfuRequestMtu{};
+                        des.object(std::get<DfuRequestMtu>(*obj.request));
+                        break;
+
+                    case DfuOpcode::NRF_DFU_OP_PING:
+                        obj.request = DfuRequestPing{};
+                        des.object(std::get<DfuRequestPing>(*obj.request));
+                        break;
+
+                    case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                        // Payload length is only known from the frame size, handled in Codec::decode
+                    case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                    case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION:
+                    case DfuOpcode::NRF_DFU_OP_ABORT:
+                    case DfuOpcode::NRF_DFU_OP_RESPONSE:
+                    case DfuOpcode::NRF_DFU_OP_INVALID:
+                    case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+                    case DfuOpcode::NRF_DFU_OP_CRC_GET:
+                        // opcodes without any extra arguments
+                        break;
+                }
             }
         };
 
@@ -243,7 +176,7 @@ namespace bitsery
                         ser.object(std::get<DfuResponseSelect>(*obj.response));
                         break;
                     case DfuOpcode::NRF_DFU_OP_MTU_GET:
-                        ser.object(std::get<DfuResponseSelect>(*obj.response));
+                        ser.object(std::get<DfuResponseMtu>(*obj.response));
                         break;
                     case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
                         ser.object(std::get<DfuResponseWrite>(*obj.response));
@@ -315,6 +248,14 @@ namespace bitsery
                         obj.response = DfuResponseFirmware{};
                         s.object(std::get<DfuResponseFirmware>(*obj.response));
                         break;
+
+                    case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                    case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                    case DfuOpcode::NRF_DFU_OP_ABORT:
+                    case DfuOpcode::NRF_DFU_OP_RESPONSE:
+                    case DfuOpcode::NRF_DFU_OP_INVALID:
+                        obj.response.reset();
+                        break;
                 }
             }
         };
@@ -354,3 +295,114 @@ namespace bitsery
 
     } // namespace traits
 } // namespace bitsery
+
+namespace NRFDL::SDFU
+{
+    template <typename S> void serialize(S & s, DfuResponseProtocol & o)
+    {
+        s.value1b(o.version);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseHardware & o)
+    {
+        s.value4b(o.part);
+        s.value4b(o.variant);
+        s.object(o.memory);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseHardwareMemory & o)
+    {
+        s.value4b(o.rom_size);
+        s.value4b(o.ram_size);
+        s.value4b(o.rom_page_size);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseFirmware & o)
+    {
+        s.value1b(o.type);
+        s.value4b(o.version);
+        s.value4b(o.addr);
+        s.value4b(o.len);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseSelect & o)
+    {
+        s.value4b(o.offset);
+        s.value4b(o.crc);
+        s.value4b(o.max_size);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseCreate & o)
+    {
+        s.value4b(o.offset);
+        s.value4b(o.crc);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseWrite & o)
+    {
+        s.value4b(o.offset);
+        s.value4b(o.crc);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseCrc & o)
+    {
+        s.value4b(o.offset);
+        s.value4b(o.crc);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponsePing & o)
+    {
+        s.value1b(o.id);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponseMtu & o)
+    {
+        s.value2b(o.size);
+    };
+
+    template <typename S> void serialize(S & s, DfuResponse & obj)
+    {
+        s.ext(obj, bitsery::ext::DfuResponseExt{});
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestFirmware & o)
+    {
+        s.value1b(o.image_number);
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestSelect & o)
+    {
+        s.value4b(o.object_type);
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestCreate & o)
+    {
+        s.value4b(o.object_type);
+        s.value4b(o.object_size);
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestWrite & o)
+    {
+        s.ext(o, bitsery::ext::DfuRequestWriteExt{});
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestPing & o)
+    {
+        s.value1b(o.id);
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestMtu & o)
+    {
+        s.value2b(o.size);
+    };
+
+    template <typename S> void serialize(S & s, DfuRequestPrn & o)
+    {
+        s.value4b(o.target);
+    };
+
+    template <typename S> void serialize(S & s, DfuRequest & o)
+    {
+        s.ext(o, bitsery::ext::DfuRequestExt{});
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,197 @@
+#include "sdfu_compact.h"
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        constexpr uint32_t kib = 1024;
+
+        template <typename T> auto details(const DfuResponse & response) -> T
+        {
+            if (response.response)
+            {
+                if (const auto details = std::get_if<T>(&*response.response))
+                {
+                    return *details;
+                }
+            }
+            return T{};
+        }
+
+        auto log2(uint32_t value) -> uint8_t
+        {
+            uint8_t bits = 0;
+            while (value > 1)
+            {
+                value >>= 1;
+                bits++;
+            }
+            return bits;
+        }
+    }; // namespace
+
+    CompactResponse::CompactResponse()
+        : _opcode(DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION)
+        , _result(DfuResult::NRF_DFU_RES_CODE_INVALID)
+        , _byte(0)
+        , _reserved(0)
+        , _words{}
+    {}
+
+    auto CompactResponse::pack(const DfuResponse & response, CompactResponse & compact) -> nrfdl_errorcode_t
+    {
+        CompactResponse packed;
+        packed._opcode = response.opcode;
+        packed._result = response.result;
+
+        switch (response.opcode)
+        {
+            case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+                packed._byte = details<DfuResponseProtocol>(response).version;
+                break;
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE: {
+                const auto create = details<DfuResponseCreate>(response);
+                packed._words[0]  = create.offset;
+                packed._words[1]  = create.crc;
+                break;
+            }
+            case DfuOpcode::NRF_DFU_OP_CRC_GET: {
+                const auto crc   = details<DfuResponseCrc>(response);
+                packed._words[0] = crc.offset;
+                packed._words[1] = crc.crc;
+                break;
+            }
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT: {
+                const auto select = details<DfuResponseSelect>(response);
+                packed._words[0]  = select.offset;
+                packed._words[1]  = select.crc;
+                packed._words[2]  = select.max_size;
+                break;
+            }
+            case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                packed._words[0] = details<DfuResponseMtu>(response).size;
+                break;
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE: {
+                const auto write = details<DfuResponseWrite>(response);
+                packed._words[0] = write.offset;
+                packed._words[1] = write.crc;
+                break;
+            }
+            case DfuOpcode::NRF_DFU_OP_PING:
+                packed._byte = details<DfuResponsePing>(response).id;
+                break;
+            case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION: {
+                const auto hardware = details<DfuResponseHardware>(response);
+                const auto & memory = hardware.memory;
+                if (memory.rom_size % kib || memory.ram_size % kib || memory.rom_size / kib > UINT16_MAX ||
+                    memory.ram_size / kib > UINT16_MAX || (memory.rom_page_size & (memory.rom_page_size - 1)))
+                {
+                    return NRFDL_ERR_ARGUMENT;
+                }
+                packed._words[0] = hardware.part;
+                packed._words[1] = hardware.variant;
+                packed._words[2] = (memory.rom_size / kib) | ((memory.ram_size / kib) << 16);
+                // A page size of 0 is kept as 0xff
+                packed._byte = memory.rom_page_size ? log2(memory.rom_page_size) : UINT8_MAX;
+                break;
+            }
+            case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION: {
+                const auto firmware = details<DfuResponseFirmware>(response);
+                packed._byte        = static_cast<uint8_t>(firmware.type);
+                packed._words[0]    = firmware.version;
+                packed._words[1]    = firmware.addr;
+                packed._words[2]    = firmware.len;
+                break;
+            }
+            default:
+                break;
+        }
+
+        compact = packed;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto CompactResponse::unpack(DfuResponse & response) const -> void
+    {
+        response.opcode = _opcode;
+        response.result = _result;
+
+        switch (_opcode)
+        {
+            case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+                response.response = DfuResponseProtocol{_byte};
+                break;
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                response.response = DfuResponseCreate{_words[0], _words[1]};
+                break;
+            case DfuOpcode::NRF_DFU_OP_CRC_GET:
+                response.response = DfuResponseCrc{_words[0], _words[1]};
+                break;
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+                response.response = DfuResponseSelect{_words[0], _words[1], _words[2]};
+                break;
+            case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                response.response = DfuResponseMtu{static_cast<uint16_t>(_words[0])};
+                break;
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                response.response = DfuResponseWrite{_words[0], _words[1]};
+                break;
+            case DfuOpcode::NRF_DFU_OP_PING:
+                response.response = DfuResponsePing{_byte};
+                break;
+            case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION:
+                response.response =
+                    DfuResponseHardware{_words[0],
+                                        _words[1],
+                                        {(_words[2] & 0xffff) * kib,
+                                         (_words[2] >> 16) * kib,
+                                         _byte == UINT8_MAX ? 0 : uint32_t{1} << _byte}};
+                break;
+            case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION:
+                response.response =
+                    DfuResponseFirmware{static_cast<DfuFirmwareType>(_byte), _words[0], _words[1], _words[2]};
+                break;
+            default:
+                response.response.reset();
+                break;
+        }
+    }
+
+    auto CompactResponse::opcode() const -> DfuOpcode
+    {
+        return _opcode;
+    }
+
+    auto CompactResponse::result() const -> DfuResult
+    {
+        return _result;
+    }
+
+    auto CompactResponse::offset() const -> uint32_t
+    {
+        switch (_opcode)
+        {
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+            case DfuOpcode::NRF_DFU_OP_CRC_GET:
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                return _words[0];
+            default:
+                return 0;
+        }
+    }
+
+    auto CompactResponse::crc() const -> uint32_t
+    {
+        switch (_opcode)
+        {
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+            case DfuOpcode::NRF_DFU_OP_CRC_GET:
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                return _words[1];
+            default:
+                return 0;
+        }
+    }
+} // namespace NRFDL::SDFU
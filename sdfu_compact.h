@@ -0,0 +1,46 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_types.h"
+
+#include <cstdint>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief 16 byte form of @ref DfuResponse for keeping or queueing many responses.
+     *
+     * The opcode is the only discriminant. The details of the opcode are held in three words and one byte: offset,
+     * CRC and maximum size of object responses, the fields of firmware responses, the MTU, ping ID or protocol version.
+     * Hardware responses keep the memory sizes in KiB and the page size as power of two, which holds for all nRF
+     * devices. Like @ref Codec::decode, responses to opcodes with details always unpack with details, zeroed if
+     * the packed response had none.
+     */
+    class CompactResponse
+    {
+      public:
+        CompactResponse();
+
+        /**
+         * @return NRFDL_ERR_ARGUMENT if the hardware memory sizes cannot be represented.
+         */
+        static auto pack(const DfuResponse & response, CompactResponse & compact) -> nrfdl_errorcode_t;
+        auto unpack(DfuResponse & response) const -> void;
+
+        auto opcode() const -> DfuOpcode;
+        auto result() const -> DfuResult;
+        /* Offset and CRC of select, create, write and CRC responses, 0 for other opcodes. */
+        auto offset() const -> uint32_t;
+        auto crc() const -> uint32_t;
+
+      private:
+        DfuOpcode _opcode;
+        DfuResult _result;
+        /* Protocol version, ping ID, firmware type or log2 of the flash page size. */
+        uint8_t _byte;
+        uint8_t _reserved;
+        uint32_t _words[3];
+    };
+
+    static_assert(sizeof(CompactResponse) == 16, "CompactResponse must stay 16 bytes");
+} // namespace NRFDL::SDFU
@@ -0,0 +1,114 @@
+#include "sdfu_crc32.h"
+
+#include <array>
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        using Table = std::array<std::array<uint32_t, 256>, 8>;
+
+        // Slicing-by-8 tables, entry [k][n] is the CRC of byte n followed by k zero bytes
+        constexpr auto makeTable() -> Table
+        {
+            Table table{};
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : (c >> 1);
+                }
+                table[0][n] = c;
+            }
+
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                for (size_t k = 1; k < table.size(); k++)
+                {
+                    table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff];
+                }
+            }
+            return table;
+        }
+
+        constexpr Table table = makeTable();
+
+        using Matrix = std::array<uint32_t, 32>;
+
+        // Multiply the GF(2) matrix, one column per bit, with the vector
+        auto times(const Matrix & matrix, uint32_t vector) -> uint32_t
+        {
+            uint32_t sum = 0;
+            for (size_t n = 0; vector; n++, vector >>= 1)
+            {
+                if (vector & 1)
+                {
+                    sum ^= matrix[n];
+                }
+            }
+            return sum;
+        }
+
+        auto square(const Matrix & matrix) -> Matrix
+        {
+            Matrix squared;
+            for (size_t n = 0; n < squared.size(); n++)
+            {
+                squared[n] = times(matrix, matrix[n]);
+            }
+            return squared;
+        }
+    } // namespace
+
+    auto crc32(const uint8_t * data, size_t size, uint32_t crc) -> uint32_t
+    {
+        crc = ~crc;
+
+        while (size >= 8)
+        {
+            const uint32_t lo =
+                (data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24)) ^ crc;
+            const uint32_t hi = data[4] | (data[5] << 8) | (data[6] << 16) | (static_cast<uint32_t>(data[7]) << 24);
+
+            crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^ table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+                  table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^ table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+
+            data += 8;
+            size -= 8;
+        }
+
+        while (size--)
+        {
+            crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xff];
+        }
+
+        return ~crc;
+    }
+
+    auto crc32Combine(uint32_t first, uint32_t second, size_t secondSize) -> uint32_t
+    {
+        // Appending zero bits to the first block is a linear operator, squared for every bit of the length
+        Matrix zeros;
+        zeros[0] = 0xEDB88320u;
+        for (size_t n = 1; n < zeros.size(); n++)
+        {
+            zeros[n] = uint32_t{1} << (n - 1);
+        }
+
+        // Start with the operator for one zero byte
+        zeros = square(square(square(zeros)));
+        for (; secondSize; secondSize >>= 1)
+        {
+            if (secondSize & 1)
+            {
+                first = times(zeros, first);
+            }
+            if (secondSize > 1)
+            {
+                zeros = square(zeros);
+            }
+        }
+        return first ^ second;
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief CRC-32 (IEEE 802.3) as computed by the bootloader for @ref DfuResponseCrc and friends.
+     *
+     * @param crc CRC of the preceding bytes, 0 to start a new computation.
+     */
+    auto crc32(const uint8_t * data, size_t size, uint32_t crc = 0) -> uint32_t;
+
+    /**
+     * @brief CRC of two concatenated blocks from the CRCs of the blocks, without their bytes.
+     *
+     * Takes time logarithmic in @p secondSize.
+     */
+    auto crc32Combine(uint32_t first, uint32_t second, size_t secondSize) -> uint32_t;
+} // namespace NRFDL::SDFU
@@ -0,0 +1,480 @@
+#include "sdfu_discovery.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        constexpr uint16_t nordicVendorId = 0x1915;
+        constexpr uint16_t seggerVendorId = 0x1366;
+        /* Product ID of the Open DFU bootloader. */
+        constexpr uint16_t nordicDfuProductId = 0x521F;
+        /* Class, subclass and protocol of the DFU trigger interface exposed by applications. */
+        constexpr uint8_t dfuTriggerInterface[3] = {0xFF, 0xFE, 0x01};
+
+        auto readAttribute(const std::string & path) -> std::string
+        {
+            std::FILE * file = std::fopen(path.c_str(), "r");
+            if (file == nullptr)
+            {
+                return {};
+            }
+
+            char buffer[256];
+            const auto size = std::fread(buffer, 1, sizeof(buffer), file);
+            std::fclose(file);
+
+            std::string value(buffer, size);
+            while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+            {
+                value.pop_back();
+            }
+            return value;
+        }
+
+        auto readHex(const std::string & path) -> uint32_t
+        {
+            return static_cast<uint32_t>(std::strtoul(readAttribute(path).c_str(), nullptr, 16));
+        }
+
+        // USB device names in sysfs are the bus, a dash and the port chain, e.g. "1-2.3.4"
+        auto isDevice(const std::string & name) -> bool
+        {
+            if (name.empty() || !std::isdigit(static_cast<unsigned char>(name.front())) ||
+                name.find('-') == std::string::npos)
+            {
+                return false;
+            }
+            return std::all_of(name.begin(), name.end(), [](char c) {
+                return std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '.';
+            });
+        }
+
+        auto same(const nrfdl_traits_t & a, const nrfdl_traits_t & b) -> bool
+        {
+            return a.usb == b.usb && a.nordic_usb == b.nordic_usb && a.nordic_dfu == b.nordic_dfu &&
+                   a.segger_usb == b.segger_usb && a.jlink == b.jlink && a.serialport == b.serialport;
+        }
+
+        auto same(const UsbDevice & a, const UsbDevice & b) -> bool
+        {
+            return a.vendor_id == b.vendor_id && a.product_id == b.product_id && a.serial_number == b.serial_number &&
+                   same(a.traits, b.traits) && a.serial_ports == b.serial_ports;
+        }
+    } // namespace
+
+    DeviceDiscovery::DeviceDiscovery()
+        : DeviceDiscovery(Config{})
+    {}
+
+    DeviceDiscovery::DeviceDiscovery(const Config & config)
+        : _config(config)
+        , _socket(-1)
+    {
+        _logger = spdlog::default_logger();
+    }
+
+    DeviceDiscovery::~DeviceDiscovery()
+    {
+#if defined(__linux__)
+        if (_socket >= 0)
+        {
+            ::close(_socket);
+        }
+#endif
+    }
+
+    auto DeviceDiscovery::scan(std::vector<DeviceEvent> & events) -> nrfdl_errorcode_t
+    {
+        namespace fs = std::filesystem;
+
+        std::error_code error;
+        std::vector<std::string> present;
+        for (fs::directory_iterator it(_config.sysfs + "/bus/usb/devices", error), end; !error && it != end;
+             it.increment(error))
+        {
+            const auto name = it->path().filename().string();
+            if (isDevice(name))
+            {
+                present.push_back(name);
+            }
+        }
+        if (error)
+        {
+            _logger->error("Unable to list USB devices: {}.", error.message());
+            return NRFDL_ERR_USB_LISTER;
+        }
+
+        // Identity of every cached device and whether it has serial ports yet
+        std::map<std::string, std::pair<std::string, bool>> known;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const auto & [topology, entry] : _cache)
+            {
+                known[topology] = {entry.identity, !entry.device.serial_ports.empty()};
+            }
+        }
+
+        // Most devices are unchanged and cost two small reads, the others are read in full in parallel. The tty of a
+        // device can bind after it was read, devices without serial ports are read again on every scan.
+        enum Status : uint8_t
+        {
+            Gone,
+            Unchanged,
+            Reread,
+            Read,
+        };
+        const auto count = present.size();
+        std::vector<Entry> entries(count);
+        std::vector<Status> status(count, Gone);
+
+        auto threads = _config.threads ? _config.threads : std::max(1u, std::thread::hardware_concurrency());
+        threads      = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threads, count / 8 + 1)));
+
+        const auto probe = [this, &present, &known, &entries, &status, count, threads](uint32_t worker) {
+            for (auto i = count * worker / threads; i < count * (worker + 1) / threads; i++)
+            {
+                const auto cached = known.find(present[i]);
+                const auto current = cached != known.end() && cached->second.first == identity(present[i]);
+                if (current && cached->second.second)
+                {
+                    status[i] = Unchanged;
+                }
+                else if (read(present[i], entries[i]))
+                {
+                    status[i] = (current && entries[i].identity == cached->second.first) ? Reread : Read;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (uint32_t worker = 1; worker < threads; worker++)
+        {
+            workers.emplace_back(probe, worker);
+        }
+        probe(0);
+        for (auto & worker : workers)
+        {
+            worker.join();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::map<std::string, Entry> cache;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (status[i] == Unchanged)
+            {
+                cache[present[i]] = std::move(_cache[present[i]]);
+            }
+            else if (const auto cached = _cache.find(present[i]); status[i] == Reread && cached != _cache.end())
+            {
+                if (!same(cached->second.device, entries[i].device))
+                {
+                    events.push_back({DeviceChange::Changed, entries[i].device});
+                }
+                cache[present[i]] = std::move(entries[i]);
+            }
+        }
+
+        // Devices unplugged or enumerated again since the last scan
+        for (const auto & [topology, entry] : _cache)
+        {
+            if (cache.count(topology) == 0)
+            {
+                events.push_back({DeviceChange::Removed, entry.device});
+            }
+        }
+
+        // Re-read devices dropped by a uevent meanwhile count as new as well
+        for (size_t i = 0; i < count; i++)
+        {
+            if (status[i] == Read || (status[i] == Reread && cache.count(present[i]) == 0))
+            {
+                events.push_back({DeviceChange::Added, entries[i].device});
+                cache[present[i]] = std::move(entries[i]);
+            }
+        }
+
+        _cache = std::move(cache);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto DeviceDiscovery::watch() -> nrfdl_errorcode_t
+    {
+#if defined(__linux__)
+        if (_socket >= 0)
+        {
+            return NRFDL_ERR_NONE;
+        }
+
+        _socket = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+        if (_socket < 0)
+        {
+            _logger->error("Unable to open uevent socket: {}.", std::strerror(errno));
+            return NRFDL_ERR_OPEN;
+        }
+
+        // Room for the uevents of many devices enumerating at once, capped by net.core.rmem_max
+        constexpr int receiveBuffer = 1024 * 1024;
+        if (::setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer)) != 0)
+        {
+            _logger->debug("Unable to enlarge uevent socket buffer: {}.", std::strerror(errno));
+        }
+
+        sockaddr_nl address{};
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = 1; // kernel events, not the ones forwarded by udev
+        if (::bind(_socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            _logger->error("Unable to bind uevent socket: {}.", std::strerror(errno));
+            ::close(_socket);
+            _socket = -1;
+            return NRFDL_ERR_OPEN;
+        }
+        return NRFDL_ERR_NONE;
+#else
+        return NRFDL_ERR_OPEN;
+#endif
+    }
+
+    auto DeviceDiscovery::poll(std::chrono::milliseconds timeout, std::vector<DeviceEvent> & events)
+        -> nrfdl_errorcode_t
+    {
+#if defined(__linux__)
+        if (_socket < 0)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        pollfd descriptor{_socket, POLLIN, 0};
+        if (::poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0)
+        {
+            return NRFDL_ERR_NONE;
+        }
+
+        char message[8192];
+        bool overflow = false;
+        for (;;)
+        {
+            const auto size = ::recv(_socket, message, sizeof(message), MSG_DONTWAIT);
+            if (size > 0)
+            {
+                handleUevent(message, static_cast<size_t>(size), events);
+            }
+            else if (size < 0 && (errno == ENOBUFS || errno == EINTR))
+            {
+                overflow = overflow || errno == ENOBUFS;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        // The kernel dropped uevents, e.g. when a whole station enumerated at once, only a scan catches up
+        if (overflow)
+        {
+            _logger->warn("Uevents were lost, rescanning USB devices.");
+            return scan(events);
+        }
+        return NRFDL_ERR_NONE;
+#else
+        (void)timeout;
+        (void)events;
+        return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+#endif
+    }
+
+    auto DeviceDiscovery::handleUevent(const char * message, size_t size, std::vector<DeviceEvent> & events) -> void
+    {
+        std::string devpath;
+        std::string subsystem;
+        for (size_t start = 0; start < size;)
+        {
+            const auto end = std::find(message + start, message + size, '\0') - message;
+            const std::string line(message + start, static_cast<size_t>(end) - start);
+            start = static_cast<size_t>(end) + 1;
+
+            if (line.rfind("DEVPATH=", 0) == 0)
+            {
+                devpath = line.substr(8);
+            }
+            else if (line.rfind("SUBSYSTEM=", 0) == 0)
+            {
+                subsystem = line.substr(10);
+            }
+        }
+
+        if (subsystem != "usb" && subsystem != "tty")
+        {
+            return;
+        }
+
+        // Events of interfaces and tty nodes refer to the device that is the last USB device on the path
+        std::string topology;
+        for (size_t start = 0; start < devpath.size();)
+        {
+            auto end = devpath.find('/', start);
+            end      = (end == std::string::npos) ? devpath.size() : end;
+
+            const auto component = devpath.substr(start, end - start);
+            if (isDevice(component))
+            {
+                topology = component;
+            }
+            start = end + 1;
+        }
+
+        if (!topology.empty())
+        {
+            refresh(topology, events);
+        }
+    }
+
+    auto DeviceDiscovery::devices() const -> std::vector<UsbDevice>
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::vector<UsbDevice> devices;
+        devices.reserve(_cache.size());
+        for (const auto & [topology, entry] : _cache)
+        {
+            devices.push_back(entry.device);
+        }
+        return devices;
+    }
+
+    auto DeviceDiscovery::device(const std::string & topology, UsbDevice & device) const -> nrfdl_errorcode_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const auto entry = _cache.find(topology);
+        if (entry == _cache.end())
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+        device = entry->second.device;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto DeviceDiscovery::devicePath(const std::string & topology) const -> std::string
+    {
+        return _config.sysfs + "/bus/usb/devices/" + topology;
+    }
+
+    auto DeviceDiscovery::identity(const std::string & topology) const -> std::string
+    {
+        const auto path   = devicePath(topology);
+        const auto devnum = readAttribute(path + "/devnum");
+        return devnum.empty() ? devnum : readAttribute(path + "/busnum") + ":" + devnum;
+    }
+
+    auto DeviceDiscovery::read(const std::string & topology, Entry & entry) const -> bool
+    {
+        namespace fs = std::filesystem;
+
+        entry.identity = identity(topology);
+        if (entry.identity.empty())
+        {
+            return false;
+        }
+
+        const auto path = devicePath(topology);
+        auto & device   = entry.device;
+
+        device.topology      = topology;
+        device.vendor_id     = static_cast<uint16_t>(readHex(path + "/idVendor"));
+        device.product_id    = static_cast<uint16_t>(readHex(path + "/idProduct"));
+        device.serial_number = readAttribute(path + "/serial");
+        device.serial_ports.clear();
+
+        bool dfuTrigger = false;
+        std::error_code error;
+        for (fs::directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+        {
+            const auto name = it->path().filename().string();
+            if (name.rfind(topology + ":", 0) != 0)
+            {
+                continue;
+            }
+
+            const auto interface = it->path().string();
+            const uint8_t kind[3] = {static_cast<uint8_t>(readHex(interface + "/bInterfaceClass")),
+                                     static_cast<uint8_t>(readHex(interface + "/bInterfaceSubClass")),
+                                     static_cast<uint8_t>(readHex(interface + "/bInterfaceProtocol"))};
+            dfuTrigger = dfuTrigger || std::equal(kind, kind + 3, dfuTriggerInterface);
+
+            // CDC ACM nodes are listed under tty/, those of USB serial converters directly in the interface
+            std::error_code ttyError;
+            for (const auto & directory : {interface + "/tty", interface})
+            {
+                for (fs::directory_iterator tty(directory, ttyError), last; !ttyError && tty != last;
+                     tty.increment(ttyError))
+                {
+                    const auto node = tty->path().filename().string();
+                    if (node.rfind("tty", 0) == 0 && node != "tty" && device.serial_ports.size() < NRFDL_MAXSERIALPORTS)
+                    {
+                        device.serial_ports.push_back(_config.dev + "/" + node);
+                    }
+                }
+            }
+        }
+        std::sort(device.serial_ports.begin(), device.serial_ports.end());
+
+        device.traits            = nrfdl_traits_t{};
+        device.traits.usb        = true;
+        device.traits.nordic_usb = device.vendor_id == nordicVendorId;
+        device.traits.nordic_dfu =
+            device.traits.nordic_usb && (device.product_id == nordicDfuProductId || dfuTrigger);
+        device.traits.segger_usb = device.vendor_id == seggerVendorId;
+        device.traits.jlink      = device.traits.segger_usb;
+        device.traits.serialport = !device.serial_ports.empty();
+        return true;
+    }
+
+    auto DeviceDiscovery::refresh(const std::string & topology, std::vector<DeviceEvent> & events) -> void
+    {
+        Entry entry;
+        const auto found = read(topology, entry);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const auto cached = _cache.find(topology);
+        if (cached != _cache.end() && (!found || cached->second.identity != entry.identity))
+        {
+            events.push_back({DeviceChange::Removed, cached->second.device});
+            _cache.erase(cached);
+        }
+        else if (cached != _cache.end())
+        {
+            if (!same(cached->second.device, entry.device))
+            {
+                events.push_back({DeviceChange::Changed, entry.device});
+                cached->second = std::move(entry);
+            }
+            return;
+        }
+
+        if (found)
+        {
+            events.push_back({DeviceChange::Added, entry.device});
+            _cache[topology] = std::move(entry);
+        }
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "nrfdl_types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief USB device found in sysfs.
+     */
+    struct UsbDevice
+    {
+        /* Topology path as named in sysfs, e.g. "1-2.3.4". Can be passed to @ref HubScheduler::groupOf. */
+        std::string topology;
+        uint16_t vendor_id = 0;
+        uint16_t product_id = 0;
+        std::string serial_number;
+        nrfdl_traits_t traits{};
+        /* Device nodes of the tty interfaces, at most NRFDL_MAXSERIALPORTS. */
+        std::vector<std::string> serial_ports;
+    };
+
+    enum class DeviceChange : uint8_t
+    {
+        Added,
+        /* Interfaces or serial ports of a known device appeared or went away. */
+        Changed,
+        Removed,
+    };
+
+    struct DeviceEvent
+    {
+        DeviceChange change;
+        UsbDevice device;
+    };
+
+    /**
+     * @brief Discovery of USB devices on Linux from sysfs.
+     *
+     * Devices are cached by topology path together with their bus and device number, which the kernel assigns anew
+     * on every enumeration. A rescan lists the USB devices, reads the device number of each and reads the remaining
+     * attributes only of devices that are new, were re-enumerated or have no serial port yet, spread over several
+     * threads. After @ref watch the cache is kept current from kernel uevents, re-reading only the device an event
+     * refers to.
+     */
+    class DeviceDiscovery
+    {
+      public:
+        struct Config
+        {
+            /* Mount point of sysfs. */
+            std::string sysfs = "/sys";
+            /* Directory of the device nodes. */
+            std::string dev = "/dev";
+            /* Threads reading devices during a scan, 0 uses one per core. */
+            uint32_t threads = 0;
+        };
+
+        DeviceDiscovery();
+        explicit DeviceDiscovery(const Config & config);
+        ~DeviceDiscovery();
+
+        DeviceDiscovery(const DeviceDiscovery &) = delete;
+        auto operator=(const DeviceDiscovery &) -> DeviceDiscovery & = delete;
+
+        /**
+         * @brief Bring the cache in line with sysfs and report what changed since the last scan.
+         *
+         * @return NRFDL_ERR_USB_LISTER if the USB devices cannot be listed.
+         */
+        auto scan(std::vector<DeviceEvent> & events) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Subscribe to kernel uevents. Events are missed until the first @ref poll.
+         *
+         * @return NRFDL_ERR_OPEN if the netlink socket cannot be opened or the platform has none.
+         */
+        auto watch() -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Wait up to @p timeout for uevents and apply them to the cache.
+         *
+         * If the socket overflowed and the kernel dropped uevents, the cache is brought back in line by a @ref scan
+         * whose events are added to those of the uevents received.
+         *
+         * @return NRFDL_ERR_RESOURCE_ILLEGAL_STATE without @ref watch, otherwise what a resync @ref scan returns.
+         */
+        auto poll(std::chrono::milliseconds timeout, std::vector<DeviceEvent> & events) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Apply one kernel uevent as received from netlink: "ACTION@DEVPATH" and KEY=VALUE lines, each
+         * terminated by a null character.
+         */
+        auto handleUevent(const char * message, size_t size, std::vector<DeviceEvent> & events) -> void;
+
+        auto devices() const -> std::vector<UsbDevice>;
+        auto device(const std::string & topology, UsbDevice & device) const -> nrfdl_errorcode_t;
+
+      private:
+        struct Entry
+        {
+            /* Bus and device number, changes when the device is enumerated again. */
+            std::string identity;
+            UsbDevice device;
+        };
+
+        auto devicePath(const std::string & topology) const -> std::string;
+        auto identity(const std::string & topology) const -> std::string;
+        auto read(const std::string & topology, Entry & entry) const -> bool;
+        auto refresh(const std::string & topology, std::vector<DeviceEvent> & events) -> void;
+
+        Config _config;
+        std::map<std::string, Entry> _cache;
+        mutable std::mutex _mutex;
+        int _socket;
+        std::shared_ptr<spdlog::logger> _logger;
+    };
+} // namespace NRFDL::SDFU
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "sdfu_types.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace NRFDL::SDFU::Frames
+{
+    /**
+     * @brief Encoded request frames of the opcodes with fixed size arguments, byte for byte what @ref Codec::encode
+     * produces. Header only requests are constants, the others are a template with the argument patched in.
+     */
+    template <size_t N> using Frame = std::array<uint8_t, N>;
+
+    namespace detail
+    {
+        template <size_t N> constexpr auto put(Frame<N> & frame, size_t offset, uint32_t value, size_t bytes) -> void
+        {
+            for (size_t i = 0; i < bytes; i++)
+            {
+                frame[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        template <size_t N> constexpr auto equal(const Frame<N> & a, const Frame<N> & b) -> bool
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                if (a[i] != b[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    } // namespace detail
+
+    constexpr auto header(DfuOpcode opcode) -> Frame<1>
+    {
+        return {static_cast<uint8_t>(opcode)};
+    }
+
+    inline constexpr Frame<1> protocolVersion = header(DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION);
+    inline constexpr Frame<1> crcGet          = header(DfuOpcode::NRF_DFU_OP_CRC_GET);
+    inline constexpr Frame<1> objectExecute   = header(DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE);
+    inline constexpr Frame<1> hardwareVersion = header(DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION);
+    inline constexpr Frame<1> abortDfu        = header(DfuOpcode::NRF_DFU_OP_ABORT);
+
+    constexpr auto ping(uint8_t id) -> Frame<2>
+    {
+        return {static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_PING), id};
+    }
+
+    constexpr auto firmwareVersion(uint8_t image) -> Frame<2>
+    {
+        return {static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION), image};
+    }
+
+    constexpr auto mtuGet(uint16_t size) -> Frame<3>
+    {
+        Frame<3> frame{static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_MTU_GET)};
+        detail::put(frame, 1, size, 2);
+        return frame;
+    }
+
+    constexpr auto receiptNotifSet(uint32_t target) -> Frame<5>
+    {
+        Frame<5> frame{static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET)};
+        detail::put(frame, 1, target, 4);
+        return frame;
+    }
+
+    constexpr auto objectSelect(uint32_t type) -> Frame<5>
+    {
+        Frame<5> frame{static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_OBJECT_SELECT)};
+        detail::put(frame, 1, type, 4);
+        return frame;
+    }
+
+    constexpr auto objectCreate(uint32_t type, uint32_t size) -> Frame<9>
+    {
+        Frame<9> frame{static_cast<uint8_t>(DfuOpcode::NRF_DFU_OP_OBJECT_CREATE)};
+        detail::put(frame, 1, type, 4);
+        detail::put(frame, 5, size, 4);
+        return frame;
+    }
+
+    /**
+     * @brief An @ref NRF_DFU_OP_OBJECT_WRITE frame is the header, the payload and the trailer with the payload length.
+     * The payload is not copied into a template, writers put the three parts next to each other.
+     */
+    inline constexpr Frame<1> writeHeader = header(DfuOpcode::NRF_DFU_OP_OBJECT_WRITE);
+
+    constexpr auto writeTrailer(uint16_t size) -> Frame<2>
+    {
+        Frame<2> frame{};
+        detail::put(frame, 0, size, 2);
+        return frame;
+    }
+
+    /* Bytes an @ref NRF_DFU_OP_OBJECT_WRITE frame adds to its payload, the header and the trailing length. */
+    inline constexpr size_t writeOverhead = writeHeader.size() + writeTrailer(0).size();
+
+    static_assert(detail::equal(objectSelect(2), {0x06, 0x02, 0x00, 0x00, 0x00}));
+    static_assert(detail::equal(writeTrailer(0x0102), {0x02, 0x01}));
+    static_assert(detail::equal(objectCreate(1, 0x1000), {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00}));
+} // namespace NRFDL::SDFU::Frames
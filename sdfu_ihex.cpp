@@ -0,0 +1,336 @@
+#include "sdfu_ihex.h"
+#include "sdfu_mapped_file.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SDFU_IHEX_SSE2
+#endif
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        enum RecordType : uint8_t
+        {
+            RECORD_DATA                  = 0x00,
+            RECORD_END_OF_FILE           = 0x01,
+            RECORD_EXTENDED_SEGMENT_ADDR = 0x02,
+            RECORD_START_SEGMENT_ADDR    = 0x03,
+            RECORD_EXTENDED_LINEAR_ADDR  = 0x04,
+            RECORD_START_LINEAR_ADDR     = 0x05,
+        };
+
+        /* Byte count, address, type, up to 255 data bytes and checksum. */
+        constexpr size_t maxRecordSize = 1 + 2 + 1 + 255 + 1;
+
+        struct Segment
+        {
+            uint64_t address;
+            size_t offset;
+            size_t size;
+        };
+
+        auto decodeNibble(char c, uint8_t & value) -> bool
+        {
+            if (c >= '0' && c <= '9')
+            {
+                value = static_cast<uint8_t>(c - '0');
+                return true;
+            }
+
+            const auto lower = static_cast<char>(c | 0x20);
+            if (lower >= 'a' && lower <= 'f')
+            {
+                value = static_cast<uint8_t>(lower - 'a' + 10);
+                return true;
+            }
+            return false;
+        }
+
+#if defined(SDFU_IHEX_SSE2)
+        // Nibble values of 16 hex characters, all lanes of valid are set if every character is a hex digit
+        inline auto decodeNibbles(__m128i chars, __m128i & valid) -> __m128i
+        {
+            const auto digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                             _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+
+            const auto lower  = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+            const auto letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                              _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+            valid = _mm_and_si128(valid, _mm_or_si128(digit, letter));
+
+            // '0'..'9' map to their low nibble, letters need 9 added to theirs
+            const auto low = _mm_and_si128(chars, _mm_set1_epi8(0x0f));
+            return _mm_add_epi8(low, _mm_and_si128(letter, _mm_set1_epi8(9)));
+        }
+
+        // Join nibble pairs, the high nibble comes first in the text
+        inline auto joinNibbles(__m128i nibbles) -> __m128i
+        {
+            const auto high = _mm_and_si128(_mm_slli_epi16(nibbles, 4), _mm_set1_epi16(0x00f0));
+            const auto low  = _mm_srli_epi16(nibbles, 8);
+            return _mm_or_si128(high, low);
+        }
+#endif
+
+        auto decodeHex(const char * text, size_t bytes, uint8_t * out) -> bool
+        {
+            size_t i = 0;
+
+#if defined(SDFU_IHEX_SSE2)
+            auto valid = _mm_set1_epi8(-1);
+            for (; i + 16 <= bytes; i += 16)
+            {
+                const auto first  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + 2 * i));
+                const auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + 2 * i + 16));
+
+                const auto packed = _mm_packus_epi16(joinNibbles(decodeNibbles(first, valid)),
+                                                     joinNibbles(decodeNibbles(second, valid)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+            }
+
+            if (_mm_movemask_epi8(valid) != 0xffff)
+            {
+                return false;
+            }
+#endif
+
+            for (; i < bytes; i++)
+            {
+                uint8_t high;
+                uint8_t low;
+                if (!decodeNibble(text[2 * i], high) || !decodeNibble(text[2 * i + 1], low))
+                {
+                    return false;
+                }
+                out[i] = static_cast<uint8_t>((high << 4) | low);
+            }
+            return true;
+        }
+
+        auto byteSum(const uint8_t * data, size_t size) -> uint8_t
+        {
+            size_t i     = 0;
+            uint32_t sum = 0;
+
+#if defined(SDFU_IHEX_SSE2)
+            auto acc = _mm_setzero_si128();
+            for (; i + 16 <= size; i += 16)
+            {
+                const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                acc              = _mm_add_epi64(acc, _mm_sad_epu8(chunk, _mm_setzero_si128()));
+            }
+            sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#endif
+
+            for (; i < size; i++)
+            {
+                sum += data[i];
+            }
+            return static_cast<uint8_t>(sum);
+        }
+    } // namespace
+
+    HexLoader::HexLoader()
+        : HexLoader(Config{})
+    {}
+
+    HexLoader::HexLoader(const Config & config)
+        : _config(config)
+    {
+        _logger = spdlog::default_logger();
+    }
+
+    auto HexLoader::parse(const char * text, size_t size, HexImage & image) -> nrfdl_errorcode_t
+    {
+        const char * p   = text;
+        const char * end = text + size;
+
+        std::vector<Segment> segments;
+        data_t bytes;
+        bytes.reserve(size / 2);
+
+        std::array<uint8_t, maxRecordSize> record;
+        uint64_t upper = 0;
+        bool eof       = false;
+        size_t index   = 0;
+
+        while (!eof)
+        {
+            while (p < end && (*p == '\r' || *p == '\n' || *p == ' ' || *p == '\t'))
+            {
+                p++;
+            }
+
+            if (p == end)
+            {
+                _logger->error("Intel HEX: missing end of file record");
+                return NRFDL_ERR_ARGUMENT;
+            }
+
+            index++;
+            if (*p++ != ':' || end - p < 10 || !decodeHex(p, 1, record.data()))
+            {
+                _logger->error("Intel HEX: malformed record {}", index);
+                return NRFDL_ERR_ARGUMENT;
+            }
+
+            const size_t count = record[0];
+            const size_t total = count + 5;
+            if (static_cast<size_t>(end - p) < 2 * total || !decodeHex(p, total, record.data()))
+            {
+                _logger->error("Intel HEX: malformed record {}", index);
+                return NRFDL_ERR_ARGUMENT;
+            }
+            p += 2 * total;
+
+            if (byteSum(record.data(), total) != 0)
+            {
+                _logger->error("Intel HEX: checksum mismatch in record {}", index);
+                return NRFDL_ERR_ARGUMENT;
+            }
+
+            const uint32_t offset = (record[1] << 8) | record[2];
+            const uint32_t value  = (count >= 2) ? ((record[4] << 8) | record[5]) : 0;
+
+            const auto isAddress =
+                record[3] == RECORD_EXTENDED_SEGMENT_ADDR || record[3] == RECORD_EXTENDED_LINEAR_ADDR;
+            if (isAddress && count != 2)
+            {
+                _logger->error("Intel HEX: malformed record {}", index);
+                return NRFDL_ERR_ARGUMENT;
+            }
+
+            switch (record[3])
+            {
+                case RECORD_DATA:
+                {
+                    const auto address = upper + offset;
+                    if (!segments.empty() && segments.back().address + segments.back().size == address)
+                    {
+                        segments.back().size += count;
+                    }
+                    else if (count > 0)
+                    {
+                        segments.push_back({address, bytes.size(), count});
+                    }
+                    bytes.insert(bytes.end(), record.begin() + 4, record.begin() + 4 + count);
+                    break;
+                }
+
+                case RECORD_END_OF_FILE:
+                    eof = true;
+                    break;
+
+                case RECORD_EXTENDED_SEGMENT_ADDR:
+                    upper = static_cast<uint64_t>(value) << 4;
+                    break;
+
+                case RECORD_EXTENDED_LINEAR_ADDR:
+                    upper = static_cast<uint64_t>(value) << 16;
+                    break;
+
+                case RECORD_START_SEGMENT_ADDR:
+                case RECORD_START_LINEAR_ADDR:
+                    // Entry point, not needed for DFU
+                    break;
+
+                default:
+                    _logger->error("Intel HEX: unknown record type {:#04x} in record {}", record[3], index);
+                    return NRFDL_ERR_ARGUMENT;
+            }
+        }
+
+        image.base = 0;
+        image.data.clear();
+        if (segments.empty())
+        {
+            return NRFDL_ERR_NONE;
+        }
+
+        const auto byAddress = [](const Segment & a, const Segment & b) { return a.address < b.address; };
+        const auto sorted    = std::is_sorted(segments.begin(), segments.end(), byAddress);
+        if (!sorted)
+        {
+            std::sort(segments.begin(), segments.end(), byAddress);
+        }
+
+        for (size_t i = 1; i < segments.size(); i++)
+        {
+            if (segments[i - 1].address + segments[i - 1].size > segments[i].address)
+            {
+                _logger->error("Intel HEX: overlapping data at {:#010x}", segments[i].address);
+                return NRFDL_ERR_ARGUMENT;
+            }
+        }
+
+        const auto first = segments.front().address;
+        const auto last  = segments.back().address + segments.back().size;
+        if (last - first > _config.max_size || last > (uint64_t{1} << 32))
+        {
+            _logger->error("Intel HEX: data spans {:#010x} to {:#010x}, larger than {} bytes",
+                           first,
+                           last,
+                           _config.max_size);
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        image.base = static_cast<uint32_t>(first);
+        if (sorted)
+        {
+            // Segments are stored in address order, spread them out in place from the back so no second buffer
+            // has to be allocated and faulted in
+            bytes.resize(static_cast<size_t>(last - first));
+            auto gapEnd = bytes.size();
+            for (auto segment = segments.rbegin(); segment != segments.rend(); ++segment)
+            {
+                const auto target = static_cast<size_t>(segment->address - first);
+                std::fill(bytes.begin() + target + segment->size, bytes.begin() + gapEnd, _config.fill);
+                std::memmove(bytes.data() + target, bytes.data() + segment->offset, segment->size);
+                gapEnd = target;
+            }
+            image.data = std::move(bytes);
+        }
+        else
+        {
+            image.data.assign(static_cast<size_t>(last - first), _config.fill);
+            for (const auto & segment : segments)
+            {
+                std::memcpy(image.data.data() + (segment.address - first), bytes.data() + segment.offset, segment.size);
+            }
+        }
+
+        _logger->debug("Intel HEX: {} bytes at {:#010x} from {} segments",
+                       image.data.size(),
+                       image.base,
+                       segments.size());
+        return NRFDL_ERR_NONE;
+    }
+
+    auto HexLoader::load(const std::string & path, HexImage & image) -> nrfdl_errorcode_t
+    {
+        MappedFile file(path);
+        if (!file.ok())
+        {
+            _logger->error("Intel HEX: cannot map {}", path);
+            return NRFDL_ERR_ARGUMENT;
+        }
+        return parse(file.data(), file.size(), image);
+    }
+
+    auto HexLoader::checkBaseAddress(const HexImage & image, const DfuResponseFirmware & firmware) -> nrfdl_errorcode_t
+    {
+        if (image.base != firmware.addr)
+        {
+            _logger->error("Image is linked at {:#010x}, the bootloader expects {:#010x}", image.base, firmware.addr);
+            return NRFDL_ERR_ARGUMENT;
+        }
+        return NRFDL_ERR_NONE;
+    }
+} // namespace NRFDL::SDFU
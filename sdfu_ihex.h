@@ -0,0 +1,68 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_codec.h"
+#include "sdfu_types.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Firmware image assembled from an Intel HEX file.
+     */
+    struct HexImage
+    {
+        /* Address of the first byte of data. */
+        uint32_t base = 0;
+        /* Contiguous image, gaps between records are filled. */
+        data_t data;
+    };
+
+    /**
+     * @brief Intel HEX loader producing images ready for chunking into @ref DfuRequestWrite payloads.
+     *
+     * Records are hex decoded and checksummed with SSE2 where available, 16 bytes per step. Adjacent records are
+     * merged into segments while parsing and the segments are laid out in one buffer at the end.
+     */
+    class HexLoader
+    {
+      public:
+        struct Config
+        {
+            /* Value of the bytes between segments. */
+            uint8_t fill = 0xFF;
+            /* Largest image accepted, guards against far apart segments such as UICR data. */
+            uint32_t max_size = 16 * 1024 * 1024;
+        };
+
+        HexLoader();
+        explicit HexLoader(const Config & config);
+
+        /**
+         * @brief Parse Intel HEX text.
+         *
+         * @return NRFDL_ERR_ARGUMENT if the text is malformed, a checksum does not match, records overlap or the image
+         * exceeds the configured size.
+         */
+        auto parse(const char * text, size_t size, HexImage & image) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Memory map and parse an Intel HEX file.
+         */
+        auto load(const std::string & path, HexImage & image) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Check that the image is linked for the address the bootloader reports for the firmware.
+         */
+        auto checkBaseAddress(const HexImage & image, const DfuResponseFirmware & firmware) -> nrfdl_errorcode_t;
+
+      private:
+        Config _config;
+        std::shared_ptr<spdlog::logger> _logger;
+    };
+} // namespace NRFDL::SDFU
@@ -0,0 +1,237 @@
+#include "sdfu_image_source.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+namespace NRFDL::SDFU
+{
+    auto ImageSource::crc(uint32_t, uint32_t, uint32_t &) -> bool
+    {
+        return false;
+    }
+
+    auto ImageSource::frames(uint32_t, uint32_t, uint16_t) -> const uint8_t *
+    {
+        return nullptr;
+    }
+
+    MemoryImageSource::MemoryImageSource(const data_t & image)
+        : _image(image)
+    {}
+
+    auto MemoryImageSource::size() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_image.size());
+    }
+
+    auto MemoryImageSource::read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t
+    {
+        if (static_cast<uint64_t>(offset) + size > _image.size())
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        data = _image.data() + offset;
+        return NRFDL_ERR_NONE;
+    }
+
+    FileImageSource::FileImageSource(const std::string & path)
+        : _file(std::fopen(path.c_str(), "rb"))
+        , _size(0)
+        , _start(0)
+        , _length(0)
+    {
+        if (_file == nullptr)
+        {
+            return;
+        }
+
+        // Windows are read straight into the buffer, stdio buffering would only copy them once more
+        std::setvbuf(_file, nullptr, _IONBF, 0);
+        if (std::fseek(_file, 0, SEEK_END) == 0)
+        {
+            _size = static_cast<uint32_t>(std::ftell(_file));
+        }
+#if defined(__linux__)
+        ::posix_fadvise(fileno(_file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    FileImageSource::~FileImageSource()
+    {
+        if (_file != nullptr)
+        {
+            std::fclose(_file);
+        }
+    }
+
+    auto FileImageSource::ok() const -> bool
+    {
+        return _file != nullptr;
+    }
+
+    auto FileImageSource::size() const -> uint32_t
+    {
+        return _size;
+    }
+
+    auto FileImageSource::read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t
+    {
+        if (_file == nullptr)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+        if (static_cast<uint64_t>(offset) + size > _size)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        // Retries of an object and writes resumed inside it stay in the buffered window
+        if (offset < _start || offset + size > _start + _length)
+        {
+            _buffer.resize(std::max<size_t>(_buffer.size(), size));
+            _length = 0;
+            if (std::fseek(_file, static_cast<long>(offset), SEEK_SET) != 0 ||
+                std::fread(_buffer.data(), 1, size, _file) != size)
+            {
+                return NRFDL_ERR_GENERIC;
+            }
+            _start  = offset;
+            _length = size;
+
+#if defined(__linux__)
+            // Sessions move through the image object by object, prefetch the next one
+            ::posix_fadvise(fileno(_file), offset + size, size, POSIX_FADV_WILLNEED);
+#endif
+        }
+
+        data = _buffer.data() + (offset - _start);
+        return NRFDL_ERR_NONE;
+    }
+
+    StreamImageSource::StreamImageSource(std::istream & stream, uint32_t size)
+        : StreamImageSource(stream, size, Config{})
+    {}
+
+    StreamImageSource::StreamImageSource(std::istream & stream, uint32_t size, const Config & config)
+        : _stream(stream)
+        , _size(size)
+        , _config(config)
+        , _spill(config.spill ? std::tmpfile() : nullptr)
+        , _consumed(0)
+        , _start(0)
+        , _length(0)
+    {}
+
+    StreamImageSource::~StreamImageSource()
+    {
+        if (_spill != nullptr)
+        {
+            std::fclose(_spill);
+        }
+    }
+
+    auto StreamImageSource::ok() const -> bool
+    {
+        return !_config.spill || _spill != nullptr;
+    }
+
+    auto StreamImageSource::size() const -> uint32_t
+    {
+        return _size;
+    }
+
+    auto StreamImageSource::read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t
+    {
+        if (static_cast<uint64_t>(offset) + size > _size)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        if (size == 0)
+        {
+            data = _buffer.data();
+            return NRFDL_ERR_NONE;
+        }
+
+        if (offset < _start || offset + size > _start + _length)
+        {
+            // Keep the buffered bytes the window overlaps at the front of the buffer
+            uint32_t kept = 0;
+            if (offset >= _start && offset < _start + _length)
+            {
+                kept = _start + _length - offset;
+                std::memmove(_buffer.data(), _buffer.data() + (offset - _start), kept);
+            }
+            _buffer.resize(std::max<size_t>(_buffer.size(), size));
+            _start  = offset;
+            _length = 0;
+
+            const auto end = offset + size;
+            auto position  = offset + kept;
+
+            // Bytes behind the stream can only come from the spill file
+            if (position < _consumed)
+            {
+                const auto count = std::min(end, _consumed) - position;
+                if (_spill == nullptr)
+                {
+                    return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+                }
+                if (std::fseek(_spill, static_cast<long>(position), SEEK_SET) != 0 ||
+                    std::fread(_buffer.data() + (position - offset), 1, count, _spill) != count)
+                {
+                    return NRFDL_ERR_GENERIC;
+                }
+                position += count;
+            }
+
+            // Skip ahead to the window, through the buffer so skipped bytes are spilled as well
+            while (_consumed < position)
+            {
+                const auto error = consume(_buffer.data(), std::min(size, position - _consumed));
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+            }
+
+            if (position < end)
+            {
+                const auto error = consume(_buffer.data() + (position - offset), end - position);
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+            }
+            _length = size;
+        }
+
+        data = _buffer.data() + (offset - _start);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto StreamImageSource::consume(uint8_t * data, uint32_t size) -> nrfdl_errorcode_t
+    {
+        _stream.read(reinterpret_cast<char *>(data), size);
+        if (static_cast<uint32_t>(_stream.gcount()) != size)
+        {
+            return _stream.bad() ? NRFDL_ERR_GENERIC : NRFDL_ERR_CLOSED;
+        }
+
+        if (_spill != nullptr)
+        {
+            if (std::fseek(_spill, static_cast<long>(_consumed), SEEK_SET) != 0 ||
+                std::fwrite(data, 1, size, _spill) != size)
+            {
+                return NRFDL_ERR_GENERIC;
+            }
+        }
+        _consumed += size;
+        return NRFDL_ERR_NONE;
+    }
+} // namespace NRFDL::SDFU
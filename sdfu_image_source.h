@@ -0,0 +1,140 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_codec.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Firmware image read in windows of at most one object.
+     *
+     * A session asks for the bytes of the object it sends and for the image prefix when it resumes, each request
+     * invalidating the previous window. Sources buffer at most the largest window, so memory per session stays at
+     * the object size of the bootloader instead of the image size. A source serves one session at a time.
+     */
+    class ImageSource
+    {
+      public:
+        virtual ~ImageSource() = default;
+
+        virtual auto size() const -> uint32_t = 0;
+
+        /**
+         * @brief Make @p size bytes at @p offset available at @p data until the next call.
+         *
+         * @return NRFDL_ERR_ARGUMENT if the window exceeds the image, NRFDL_ERR_RESOURCE_ILLEGAL_STATE if the bytes
+         * cannot be read again, NRFDL_ERR_CLOSED if the image ends early, NRFDL_ERR_GENERIC on I/O errors.
+         */
+        virtual auto read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t = 0;
+
+        /**
+         * @brief Continue @p crc over a window without reading it.
+         *
+         * @return false if the source does not know the CRC of the window, @p crc is unchanged then.
+         */
+        virtual auto crc(uint32_t offset, uint32_t size, uint32_t & crc) -> bool;
+
+        /**
+         * @brief @ref NRF_DFU_OP_OBJECT_WRITE frames of a window with @p chunk payload bytes each, encoded back to
+         * back. They stay valid as long as the source.
+         *
+         * @return nullptr if the source has none for the window.
+         */
+        virtual auto frames(uint32_t offset, uint32_t size, uint16_t chunk) -> const uint8_t *;
+    };
+
+    /**
+     * @brief Image already in memory, windows point into it.
+     */
+    class MemoryImageSource : public ImageSource
+    {
+      public:
+        explicit MemoryImageSource(const data_t & image);
+
+        auto size() const -> uint32_t override;
+        auto read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t override;
+
+      private:
+        const data_t & _image;
+    };
+
+    /**
+     * @brief Image file read one window at a time.
+     *
+     * Where the platform allows it the kernel is asked to read the following window ahead, so the next object is in
+     * the page cache by the time the session creates it. Going back, e.g. to resume, reads the file again.
+     */
+    class FileImageSource : public ImageSource
+    {
+      public:
+        explicit FileImageSource(const std::string & path);
+        ~FileImageSource() override;
+
+        FileImageSource(const FileImageSource &) = delete;
+        auto operator=(const FileImageSource &) -> FileImageSource & = delete;
+
+        auto ok() const -> bool;
+        auto size() const -> uint32_t override;
+        auto read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t override;
+
+      private:
+        std::FILE * _file;
+        uint32_t _size;
+        std::vector<uint8_t> _buffer;
+        /* Image range held by the buffer. */
+        uint32_t _start;
+        uint32_t _length;
+    };
+
+    /**
+     * @brief Image of known size read once from a stream, e.g. a pipe from a build server.
+     *
+     * Windows move forward through the stream, overlapping bytes are kept. The bytes of an earlier window can only
+     * be read again, e.g. by a session resuming the transfer, if the source spills what it reads into a temporary
+     * file.
+     */
+    class StreamImageSource : public ImageSource
+    {
+      public:
+        struct Config
+        {
+            /* Keep everything read in an anonymous temporary file to serve windows behind the stream. */
+            bool spill = false;
+        };
+
+        /**
+         * @param size Size of the image, e.g. from the manifest or the init packet.
+         */
+        StreamImageSource(std::istream & stream, uint32_t size);
+        StreamImageSource(std::istream & stream, uint32_t size, const Config & config);
+        ~StreamImageSource() override;
+
+        StreamImageSource(const StreamImageSource &) = delete;
+        auto operator=(const StreamImageSource &) -> StreamImageSource & = delete;
+
+        /* False if the spill file could not be created. */
+        auto ok() const -> bool;
+        auto size() const -> uint32_t override;
+        auto read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t override;
+
+      private:
+        /* Read the next bytes of the stream, appending them to the spill file. */
+        auto consume(uint8_t * data, uint32_t size) -> nrfdl_errorcode_t;
+
+        std::istream & _stream;
+        uint32_t _size;
+        Config _config;
+        std::FILE * _spill;
+        /* Bytes taken from the stream so far. */
+        uint32_t _consumed;
+        std::vector<uint8_t> _buffer;
+        uint32_t _start;
+        uint32_t _length;
+    };
+} // namespace NRFDL::SDFU
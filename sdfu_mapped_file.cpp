@@ -0,0 +1,92 @@
+#include "sdfu_mapped_file.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace NRFDL::SDFU
+{
+#if !defined(_WIN32)
+    MappedFile::MappedFile(const std::string & path)
+    {
+        _fd = ::open(path.c_str(), O_RDONLY);
+        if (_fd < 0)
+        {
+            return;
+        }
+
+        struct stat st;
+        if (::fstat(_fd, &st) != 0)
+        {
+            return;
+        }
+
+        _size = static_cast<size_t>(st.st_size);
+        if (_size == 0)
+        {
+            _ok = true;
+            return;
+        }
+
+        auto address = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (address == MAP_FAILED)
+        {
+            return;
+        }
+
+        ::madvise(address, _size, MADV_SEQUENTIAL);
+        _data   = static_cast<const char *>(address);
+        _mapped = true;
+        _ok     = true;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (_mapped)
+        {
+            ::munmap(const_cast<char *>(_data), _size);
+        }
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::string & path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return;
+        }
+
+        _contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        _data = _contents.data();
+        _size = _contents.size();
+        _ok   = true;
+    }
+
+    MappedFile::~MappedFile() = default;
+#endif
+
+    auto MappedFile::ok() const -> bool
+    {
+        return _ok;
+    }
+
+    auto MappedFile::data() const -> const char *
+    {
+        return _data;
+    }
+
+    auto MappedFile::size() const -> size_t
+    {
+        return _size;
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Read only view of a whole file, memory mapped where the platform allows it.
+     *
+     * On Windows the file is read into memory instead.
+     */
+    class MappedFile
+    {
+      public:
+        explicit MappedFile(const std::string & path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+        auto ok() const -> bool;
+        auto data() const -> const char *;
+        auto size() const -> size_t;
+
+      private:
+        int _fd            = -1;
+        const char * _data = nullptr;
+        size_t _size       = 0;
+        bool _ok           = false;
+        bool _mapped       = false;
+        std::string _contents;
+    };
+} // namespace NRFDL::SDFU
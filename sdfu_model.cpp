@@ -0,0 +1,336 @@
+#include "sdfu_model.h"
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_session.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        constexpr size_t parameterCount = 4;
+
+        using Features = std::array<double, parameterCount>;
+
+        auto featuresOf(const TransferCounts & counts) -> Features
+        {
+            return {static_cast<double>(counts.tx_bytes + counts.rx_bytes),
+                    static_cast<double>(counts.round_trips),
+                    static_cast<double>(counts.erased_pages),
+                    static_cast<double>(counts.executes)};
+        }
+
+        auto duration(const TransferCounts & counts, const LinkParameters & parameters, double bandwidth) -> double
+        {
+            const auto f = featuresOf(counts);
+            return f[0] / bandwidth + f[1] * parameters.latency + f[2] * parameters.create_cost +
+                   f[3] * parameters.execute_cost;
+        }
+
+        // Flash pages a create of the object erases on the simulated device
+        auto erasedPages(const DfuRequest & request, uint32_t pageSize) -> uint64_t
+        {
+            const auto create = request.request ? std::get_if<DfuRequestCreate>(&*request.request) : nullptr;
+            if (create == nullptr ||
+                static_cast<DfuObjecType>(create->object_type) != DfuObjecType::NRF_DFU_OBJ_TYPE_DATA)
+            {
+                return 0;
+            }
+            return (create->object_size + pageSize - 1) / pageSize;
+        }
+
+        // Least squares over the features marked active, inactive coefficients are zero
+        auto solve(const std::vector<Features> & x,
+                   const std::vector<double> & y,
+                   std::array<bool, parameterCount> & active,
+                   Features & theta) -> void
+        {
+            std::array<std::array<double, parameterCount + 1>, parameterCount> a{};
+            for (size_t row = 0; row < x.size(); row++)
+            {
+                for (size_t i = 0; i < parameterCount; i++)
+                {
+                    for (size_t j = 0; j < parameterCount; j++)
+                    {
+                        a[i][j] += x[row][i] * x[row][j];
+                    }
+                    a[i][parameterCount] += x[row][i] * y[row];
+                }
+            }
+
+            for (size_t i = 0; i < parameterCount; i++)
+            {
+                if (!active[i])
+                {
+                    for (auto & row : a)
+                    {
+                        row[i] = 0;
+                    }
+                    a[i].fill(0);
+                    a[i][i] = 1;
+                }
+            }
+
+            // Gaussian elimination with partial pivoting, a degenerate column deactivates its feature
+            for (size_t col = 0; col < parameterCount; col++)
+            {
+                size_t pivot = col;
+                for (size_t row = col + 1; row < parameterCount; row++)
+                {
+                    if (std::fabs(a[row][col]) > std::fabs(a[pivot][col]))
+                    {
+                        pivot = row;
+                    }
+                }
+                std::swap(a[col], a[pivot]);
+
+                if (std::fabs(a[col][col]) < 1e-9)
+                {
+                    active[col] = false;
+                    theta.fill(0);
+                    return;
+                }
+
+                for (size_t row = 0; row < parameterCount; row++)
+                {
+                    if (row != col)
+                    {
+                        const auto factor = a[row][col] / a[col][col];
+                        for (size_t k = col; k <= parameterCount; k++)
+                        {
+                            a[row][k] -= factor * a[col][k];
+                        }
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < parameterCount; i++)
+            {
+                theta[i] = active[i] ? a[i][parameterCount] / a[i][i] : 0;
+            }
+        }
+    } // namespace
+
+    DurationModel::DurationModel()
+        : DurationModel(LinkParameters{})
+    {}
+
+    DurationModel::DurationModel(const LinkParameters & parameters)
+        : _parameters(parameters)
+    {}
+
+    auto DurationModel::count(const TransferProfile & profile, TransferCounts & counts) -> nrfdl_errorcode_t
+    {
+        const ProfileKey key{profile.init_size, profile.image_size, profile.mtu, profile.max_size, profile.prn};
+        if (const auto it = _counts.find(key); it != _counts.end())
+        {
+            counts = it->second;
+            return NRFDL_ERR_NONE;
+        }
+
+        data_t init(profile.init_size);
+        data_t firmware(profile.image_size);
+        for (size_t i = 0; i < firmware.size(); i++)
+        {
+            firmware[i] = static_cast<uint8_t>(i * 7);
+        }
+
+        SimBootloader::Config bootloader;
+        bootloader.mtu              = profile.mtu;
+        bootloader.data_max_size    = profile.max_size;
+        bootloader.command_max_size = std::max(bootloader.command_max_size, profile.init_size);
+        SimBootloader device(bootloader);
+
+        Session::Config config;
+        config.prn = profile.prn;
+        config.mtu = profile.mtu;
+        Session session(init, firmware, config);
+
+        TransferCounts result;
+        DfuRequest request;
+        DfuResponse response;
+        data_t packet;
+        data_t reply;
+
+        while (!session.done())
+        {
+            auto error = session.next(request);
+            if (error == NRFDL_ERR_NONE)
+            {
+                error = _codec.encode(request, packet);
+            }
+            if (error == NRFDL_ERR_NONE)
+            {
+                error = device.process(packet, reply);
+            }
+            if (error != NRFDL_ERR_NONE)
+            {
+                return error;
+            }
+
+            result.tx_bytes += packet.size();
+            result.requests++;
+            result.creates += request.opcode == DfuOpcode::NRF_DFU_OP_OBJECT_CREATE;
+            result.executes += request.opcode == DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE;
+            result.erased_pages += erasedPages(request, bootloader.hardware.memory.rom_page_size);
+
+            if (!reply.empty())
+            {
+                result.rx_bytes += reply.size();
+                result.round_trips++;
+
+                error = _codec.decode(reply, response);
+                if (error == NRFDL_ERR_NONE)
+                {
+                    error = session.handle(response);
+                }
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+            }
+        }
+
+        _counts.emplace(key, result);
+        counts = result;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto DurationModel::predict(const TransferCounts & counts) const -> double
+    {
+        return duration(counts, _parameters, _parameters.bandwidth);
+    }
+
+    auto DurationModel::predict(const TransferProfile & profile, double & seconds) -> nrfdl_errorcode_t
+    {
+        TransferCounts counts;
+        const auto error = count(profile, counts);
+        if (error == NRFDL_ERR_NONE)
+        {
+            seconds = predict(counts);
+        }
+        return error;
+    }
+
+    auto DurationModel::predict(const std::vector<StationGroup> & station, double & seconds) -> nrfdl_errorcode_t
+    {
+        seconds = 0;
+
+        for (const auto & group : station)
+        {
+            if (group.concurrency == 0)
+            {
+                return NRFDL_ERR_ARGUMENT;
+            }
+
+            if (group.devices.empty())
+            {
+                continue;
+            }
+
+            // Sessions beyond the number of devices stay idle and take no share of the hub
+            const auto busy = std::min<size_t>(group.concurrency, group.devices.size());
+            auto bandwidth  = _parameters.bandwidth;
+            if (group.bandwidth > 0)
+            {
+                bandwidth = std::min(bandwidth, group.bandwidth / busy);
+            }
+
+            std::vector<double> sessions(busy, 0.0);
+            for (const auto & device : group.devices)
+            {
+                TransferCounts counts;
+                const auto error = count(device, counts);
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+
+                *std::min_element(sessions.begin(), sessions.end()) += duration(counts, _parameters, bandwidth);
+            }
+
+            seconds = std::max(seconds, *std::max_element(sessions.begin(), sessions.end()));
+        }
+
+        return NRFDL_ERR_NONE;
+    }
+
+    auto DurationModel::calibrate(const std::vector<SessionTiming> & timings) -> nrfdl_errorcode_t
+    {
+        std::vector<Features> x;
+        std::vector<double> y;
+
+        for (const auto & timing : timings)
+        {
+            TransferCounts counts;
+            const auto error = count(timing.profile, counts);
+            if (error != NRFDL_ERR_NONE)
+            {
+                return error;
+            }
+            x.push_back(featuresOf(counts));
+            y.push_back(timing.seconds);
+        }
+
+        // Normalize the columns, byte counts are orders of magnitude larger than object counts
+        Features scale{};
+        for (const auto & row : x)
+        {
+            for (size_t i = 0; i < parameterCount; i++)
+            {
+                scale[i] = std::max(scale[i], row[i]);
+            }
+        }
+
+        std::array<bool, parameterCount> active{};
+        for (size_t i = 0; i < parameterCount; i++)
+        {
+            active[i] = scale[i] > 0;
+            scale[i]  = active[i] ? scale[i] : 1;
+        }
+        for (auto & row : x)
+        {
+            for (size_t i = 0; i < parameterCount; i++)
+            {
+                row[i] /= scale[i];
+            }
+        }
+
+        // Drop features with negative cost until the fit is physical
+        Features theta{};
+        for (size_t attempt = 0; attempt < 2 * parameterCount; attempt++)
+        {
+            const auto before = active;
+            solve(x, y, active, theta);
+            if (active != before)
+            {
+                continue;
+            }
+
+            const auto worst = std::min_element(theta.begin(), theta.end());
+            if (*worst >= 0)
+            {
+                break;
+            }
+            active[static_cast<size_t>(worst - theta.begin())] = false;
+        }
+
+        if (theta[0] <= 0)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        _parameters.bandwidth    = scale[0] / theta[0];
+        _parameters.latency      = theta[1] / scale[1];
+        _parameters.create_cost  = theta[2] / scale[2];
+        _parameters.execute_cost = theta[3] / scale[3];
+        return NRFDL_ERR_NONE;
+    }
+
+    auto DurationModel::parameters() const -> const LinkParameters &
+    {
+        return _parameters;
+    }
+} // namespace NRFDL::SDFU
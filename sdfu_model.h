@@ -0,0 +1,122 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_codec.h"
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Sizes and settings that determine the frames of one update.
+     */
+    struct TransferProfile
+    {
+        uint32_t init_size  = 256;
+        uint32_t image_size = 0;
+        /* MTU reported by the bootloader, see @ref DfuResponseMtu. */
+        uint16_t mtu = 1024;
+        /* Data object size, see @ref DfuResponseSelect::max_size. */
+        uint32_t max_size = 4096;
+        uint32_t prn      = 0;
+    };
+
+    /**
+     * @brief Protocol work done by one update.
+     */
+    struct TransferCounts
+    {
+        uint64_t tx_bytes     = 0;
+        uint64_t rx_bytes     = 0;
+        uint64_t requests     = 0;
+        /* Responses the host had to wait for. */
+        uint64_t round_trips  = 0;
+        uint64_t creates      = 0;
+        uint64_t executes     = 0;
+        /* Flash pages erased by data object creates, command objects are kept in RAM. */
+        uint64_t erased_pages = 0;
+    };
+
+    /**
+     * @brief Cost of the link and the bootloader.
+     */
+    struct LinkParameters
+    {
+        /* Bytes per second in each direction. */
+        double bandwidth = 11520;
+        /* Seconds per request/response turnaround. */
+        double latency = 0.002;
+        /* Seconds per flash page erased by a data object create. */
+        double create_cost = 0.09;
+        /* Seconds per object execute. */
+        double execute_cost = 0.01;
+    };
+
+    /**
+     * @brief Measured duration of a past update.
+     */
+    struct SessionTiming
+    {
+        TransferProfile profile;
+        double seconds;
+    };
+
+    /**
+     * @brief Devices behind one hub, sharing its bandwidth.
+     */
+    struct StationGroup
+    {
+        std::vector<TransferProfile> devices;
+        /* Sessions run in parallel on the hub. */
+        uint32_t concurrency = 1;
+        /* Upstream bandwidth of the hub in bytes per second, 0 if the hub is not the bottleneck. */
+        double bandwidth = 0;
+    };
+
+    /**
+     * @brief Predicts update durations by replaying the transfer offline.
+     *
+     * A @ref Session is run against a @ref SimBootloader and every frame goes through the @ref Codec, so the frame
+     * sizes, receipts and object boundaries are those of a real update. The duration is linear in the resulting
+     * @ref TransferCounts, which is also what makes calibrating the @ref LinkParameters from recorded sessions a
+     * least squares fit.
+     */
+    class DurationModel
+    {
+      public:
+        DurationModel();
+        explicit DurationModel(const LinkParameters & parameters);
+
+        auto count(const TransferProfile & profile, TransferCounts & counts) -> nrfdl_errorcode_t;
+
+        auto predict(const TransferCounts & counts) const -> double;
+        auto predict(const TransferProfile & profile, double & seconds) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Predict the time until every device of the station is updated.
+         *
+         * Each group hands devices to its sessions in order as they become free. Concurrent sessions split the hub
+         * bandwidth evenly.
+         */
+        auto predict(const std::vector<StationGroup> & station, double & seconds) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Fit the link parameters to recorded sessions.
+         *
+         * @return NRFDL_ERR_ARGUMENT if the timings do not determine a usable bandwidth.
+         */
+        auto calibrate(const std::vector<SessionTiming> & timings) -> nrfdl_errorcode_t;
+
+        auto parameters() const -> const LinkParameters &;
+
+      private:
+        using ProfileKey = std::tuple<uint32_t, uint32_t, uint16_t, uint32_t, uint32_t>;
+
+        LinkParameters _parameters;
+        Codec _codec;
+        std::map<ProfileKey, TransferCounts> _counts;
+    };
+} // namespace NRFDL::SDFU
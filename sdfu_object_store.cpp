@@ -0,0 +1,210 @@
+#include "sdfu_object_store.h"
+#include "sdfu_crc32.h"
+#include "sdfu_frames.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace NRFDL::SDFU
+{
+    StoredImage::StoredImage(std::vector<std::shared_ptr<const StoredObject>> objects,
+                             uint32_t size,
+                             uint32_t objectSize,
+                             uint16_t chunk)
+        : _objects(std::move(objects))
+        , _size(size)
+        , _objectSize(objectSize)
+        , _chunk(chunk)
+    {}
+
+    auto StoredImage::size() const -> uint32_t
+    {
+        return _size;
+    }
+
+    auto StoredImage::read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t
+    {
+        if (static_cast<uint64_t>(offset) + size > _size)
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        auto index  = offset / _objectSize;
+        auto within = offset % _objectSize;
+        if (size == 0 || within + size <= _objectSize)
+        {
+            data = (size > 0) ? _objects[index]->data.data() + within : _buffer.data();
+            return NRFDL_ERR_NONE;
+        }
+
+        _buffer.resize(size);
+        for (uint32_t copied = 0; copied < size; index++, within = 0)
+        {
+            const auto & object = _objects[index]->data;
+            const auto count    = std::min<uint32_t>(static_cast<uint32_t>(object.size()) - within, size - copied);
+            std::memcpy(_buffer.data() + copied, object.data() + within, count);
+            copied += count;
+        }
+        data = _buffer.data();
+        return NRFDL_ERR_NONE;
+    }
+
+    auto StoredImage::crc(uint32_t offset, uint32_t size, uint32_t & crc) -> bool
+    {
+        const auto end = offset + size;
+        if (end > _size || offset % _objectSize || (end % _objectSize && end != _size))
+        {
+            return false;
+        }
+
+        for (auto index = offset / _objectSize; index * _objectSize < end; index++)
+        {
+            const auto & object = *_objects[index];
+            crc                 = crc32Combine(crc, object.crc, object.data.size());
+        }
+        return true;
+    }
+
+    auto StoredImage::frames(uint32_t offset, uint32_t size, uint16_t chunk) -> const uint8_t *
+    {
+        if (chunk == 0 || chunk != _chunk || offset % _objectSize || offset >= _size)
+        {
+            return nullptr;
+        }
+
+        const auto & object = *_objects[offset / _objectSize];
+        return (size == object.data.size()) ? object.frames.data() : nullptr;
+    }
+
+    auto StoredImage::objects() const -> const std::vector<std::shared_ptr<const StoredObject>> &
+    {
+        return _objects;
+    }
+
+    ObjectStore::ObjectStore()
+        : ObjectStore(Config{})
+    {}
+
+    ObjectStore::ObjectStore(const Config & config)
+        : _config(config)
+    {
+        _config.object_size = std::max<uint32_t>(_config.object_size, 1);
+    }
+
+    auto ObjectStore::add(const data_t & image) -> StoredImage
+    {
+        const auto size  = static_cast<uint32_t>(image.size());
+        const auto count = (size + _config.object_size - 1) / _config.object_size;
+
+        // Hash outside the lock
+        std::vector<Sha256Digest> digests(count);
+        for (uint32_t index = 0; index < count; index++)
+        {
+            const auto offset = index * _config.object_size;
+            digests[index]    = sha256(image.data() + offset, std::min(_config.object_size, size - offset));
+        }
+
+        std::vector<std::shared_ptr<const StoredObject>> objects(count);
+        std::vector<uint32_t> missing;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (uint32_t index = 0; index < count; index++)
+            {
+                if (const auto entry = _objects.find(digests[index]); entry != _objects.end())
+                {
+                    objects[index] = entry->second.lock();
+                }
+                if (!objects[index])
+                {
+                    missing.push_back(index);
+                }
+            }
+        }
+
+        // Copy, CRC and encode the objects not held yet without blocking other images, repeats within the image
+        // are prepared once
+        std::map<Sha256Digest, std::shared_ptr<const StoredObject>> prepared;
+        for (const auto index : missing)
+        {
+            auto & object = prepared[digests[index]];
+            if (!object)
+            {
+                const auto offset = index * _config.object_size;
+                object = prepare(image.data() + offset, std::min(_config.object_size, size - offset), digests[index]);
+            }
+            objects[index] = object;
+        }
+
+        // Publish, an image added meanwhile may have stored the same objects first
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (auto entry = _objects.begin(); entry != _objects.end();)
+        {
+            entry = entry->second.expired() ? _objects.erase(entry) : std::next(entry);
+        }
+
+        for (const auto index : missing)
+        {
+            auto & stored = _objects[digests[index]];
+            if (auto object = stored.lock())
+            {
+                objects[index] = std::move(object);
+            }
+            else
+            {
+                stored = objects[index];
+            }
+        }
+
+        return StoredImage(std::move(objects), size, _config.object_size, _config.chunk);
+    }
+
+    auto ObjectStore::objects() const -> size_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return std::count_if(_objects.begin(), _objects.end(), [](const auto & entry) {
+            return !entry.second.expired();
+        });
+    }
+
+    auto ObjectStore::bytes() const -> size_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        size_t bytes = 0;
+        for (const auto & entry : _objects)
+        {
+            if (const auto object = entry.second.lock())
+            {
+                bytes += object->data.size() + object->frames.size();
+            }
+        }
+        return bytes;
+    }
+
+    auto ObjectStore::prepare(const uint8_t * data, uint32_t size, const Sha256Digest & digest) const
+        -> std::shared_ptr<const StoredObject>
+    {
+        auto object    = std::make_shared<StoredObject>();
+        object->digest = digest;
+        object->data.assign(data, data + size);
+        object->crc = crc32(data, size);
+
+        if (_config.chunk > 0)
+        {
+            // One frame per chunk, as FrameBatch::addWrite lays them out
+            const auto writes = (size + _config.chunk - 1) / _config.chunk;
+            auto & frames     = object->frames;
+            frames.reserve(size + writes * Frames::writeOverhead);
+            for (uint32_t offset = 0; offset < size; offset += _config.chunk)
+            {
+                const auto length  = static_cast<uint16_t>(std::min<uint32_t>(_config.chunk, size - offset));
+                const auto trailer = Frames::writeTrailer(length);
+                frames.insert(frames.end(), Frames::writeHeader.begin(), Frames::writeHeader.end());
+                frames.insert(frames.end(), data + offset, data + offset + length);
+                frames.insert(frames.end(), trailer.begin(), trailer.end());
+            }
+        }
+        return object;
+    }
+} // namespace NRFDL::SDFU
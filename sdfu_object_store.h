@@ -0,0 +1,99 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_codec.h"
+#include "sdfu_image_source.h"
+#include "sdfu_sha256.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Data object shared by all images containing its bytes.
+     */
+    struct StoredObject
+    {
+        Sha256Digest digest;
+        data_t data;
+        /* CRC of the object alone, see @ref crc32Combine. */
+        uint32_t crc;
+        /* @ref NRF_DFU_OP_OBJECT_WRITE frames of the object encoded back to back, empty without a chunk size. They
+         * hold a second copy of the data. */
+        data_t frames;
+    };
+
+    /**
+     * @brief Firmware image as a list of stored objects, a source for @ref Session.
+     *
+     * Windows inside one object point into it, windows spanning objects are copied into a buffer of the image. The
+     * CRC of object aligned windows is combined from the object CRCs and the pre-encoded writes of an object are
+     * handed out for @ref Session::nextBatch. Copies share the objects, give every session its own copy.
+     */
+    class StoredImage : public ImageSource
+    {
+      public:
+        StoredImage(std::vector<std::shared_ptr<const StoredObject>> objects,
+                    uint32_t size,
+                    uint32_t objectSize,
+                    uint16_t chunk);
+
+        auto size() const -> uint32_t override;
+        auto read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t override;
+        auto crc(uint32_t offset, uint32_t size, uint32_t & crc) -> bool override;
+        auto frames(uint32_t offset, uint32_t size, uint16_t chunk) -> const uint8_t * override;
+
+        auto objects() const -> const std::vector<std::shared_ptr<const StoredObject>> &;
+
+      private:
+        std::vector<std::shared_ptr<const StoredObject>> _objects;
+        uint32_t _size;
+        uint32_t _objectSize;
+        uint16_t _chunk;
+        data_t _buffer;
+    };
+
+    /**
+     * @brief Content addressed store of data objects shared across firmware variants.
+     *
+     * Images are split at the data object size of the bootloader and every object is identified by its SHA-256.
+     * Objects already held for another image, e.g. a variant built for another region, are shared instead of being
+     * stored, CRC'd and encoded again. Objects are reference counted by the images using them and dropped with the
+     * last one. Pre-encoded writes keep every object twice, once as data and once inside its frames, trading memory
+     * for the copies of every session. Thread safe.
+     */
+    class ObjectStore
+    {
+      public:
+        struct Config
+        {
+            /* Data object size the bootloaders report in DfuResponseSelect::max_size. */
+            uint32_t object_size = 4096;
+            /* Payload bytes of the pre-encoded writes, writePayloadSize() of the session MTU. 0 encodes none. */
+            uint16_t chunk = 0;
+        };
+
+        ObjectStore();
+        explicit ObjectStore(const Config & config);
+
+        auto add(const data_t & image) -> StoredImage;
+
+        /* Distinct objects held by images alive. */
+        auto objects() const -> size_t;
+        /* Memory held by those objects, their data and pre-encoded frames. */
+        auto bytes() const -> size_t;
+
+      private:
+        auto prepare(const uint8_t * data, uint32_t size, const Sha256Digest & digest) const
+            -> std::shared_ptr<const StoredObject>;
+
+        Config _config;
+        mutable std::mutex _mutex;
+        std::map<Sha256Digest, std::weak_ptr<const StoredObject>> _objects;
+    };
+} // namespace NRFDL::SDFU
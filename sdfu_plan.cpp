@@ -0,0 +1,165 @@
+/*
+ * Capacity planning for DFU stations.
+ *
+ * Predicts the update time of one device and of a station of identical devices from the transfer settings and the
+ * link parameters. The link parameters can be fitted to recorded sessions given as CSV lines of
+ * init_size,image_size,mtu,max_size,prn,seconds.
+ */
+#include "sdfu_model.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto usage() -> int
+    {
+        fmt::print(stderr,
+                   "usage: sdfu_plan --image <bytes> [--init <bytes>] [--mtu <bytes>]\n"
+                   "                 [--max-size <bytes>] [--prn <n>]\n"
+                   "                 [--bandwidth <B/s>] [--latency <s>] [--create-cost <s>] [--execute-cost <s>]\n"
+                   "                 [--calibrate <timings.csv>]\n"
+                   "                 [--devices <n>] [--hubs <n>] [--concurrency <n>] [--hub-bandwidth <B/s>]\n");
+        return EXIT_FAILURE;
+    }
+
+    auto readTimings(const std::string & path, std::vector<SessionTiming> & timings) -> bool
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream fields(line);
+
+            SessionTiming timing;
+            if (fields >> timing.profile.init_size >> timing.profile.image_size >> timing.profile.mtu >>
+                timing.profile.max_size >> timing.profile.prn >> timing.seconds)
+            {
+                timings.push_back(timing);
+            }
+        }
+        return true;
+    }
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    std::map<std::string, std::string> options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string key = argv[i];
+        if (key.rfind("--", 0) != 0)
+        {
+            return usage();
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+
+    const auto number = [&options](const std::string & key, double fallback) {
+        const auto it = options.find(key);
+        return (it == options.end()) ? fallback : std::strtod(it->second.c_str(), nullptr);
+    };
+
+    if (argc % 2 == 0 || options.count("image") == 0)
+    {
+        return usage();
+    }
+
+    TransferProfile profile;
+    profile.image_size = static_cast<uint32_t>(number("image", 0));
+    profile.init_size  = static_cast<uint32_t>(number("init", profile.init_size));
+    profile.mtu        = static_cast<uint16_t>(number("mtu", profile.mtu));
+    profile.max_size   = static_cast<uint32_t>(number("max-size", profile.max_size));
+    profile.prn        = static_cast<uint32_t>(number("prn", profile.prn));
+
+    LinkParameters link;
+    link.bandwidth    = number("bandwidth", link.bandwidth);
+    link.latency      = number("latency", link.latency);
+    link.create_cost  = number("create-cost", link.create_cost);
+    link.execute_cost = number("execute-cost", link.execute_cost);
+
+    DurationModel model(link);
+
+    if (options.count("calibrate"))
+    {
+        std::vector<SessionTiming> timings;
+        if (!readTimings(options["calibrate"], timings))
+        {
+            fmt::print(stderr, "Cannot read {}\n", options["calibrate"]);
+            return EXIT_FAILURE;
+        }
+
+        if (model.calibrate(timings) != NRFDL_ERR_NONE)
+        {
+            fmt::print(stderr, "Calibration from {} sessions failed\n", timings.size());
+            return EXIT_FAILURE;
+        }
+
+        const auto & fitted = model.parameters();
+        fmt::print("Calibrated from {} sessions: bandwidth {:.0f} B/s, latency {:.2f} ms, create {:.2f} ms per page, "
+                   "execute {:.2f} ms\n",
+                   timings.size(),
+                   fitted.bandwidth,
+                   fitted.latency * 1e3,
+                   fitted.create_cost * 1e3,
+                   fitted.execute_cost * 1e3);
+    }
+
+    TransferCounts counts;
+    if (model.count(profile, counts) != NRFDL_ERR_NONE)
+    {
+        fmt::print(stderr, "Transfer settings are not valid\n");
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("Device: {} requests, {} B sent, {} B received, {} round trips, {} objects\n",
+               counts.requests,
+               counts.tx_bytes,
+               counts.rx_bytes,
+               counts.round_trips,
+               counts.creates);
+    fmt::print("Device: {:.2f} s\n", model.predict(counts));
+
+    const auto devices = static_cast<uint32_t>(number("devices", 0));
+    if (devices > 0)
+    {
+        const auto hubs = std::max<uint32_t>(1, static_cast<uint32_t>(number("hubs", 1)));
+
+        std::vector<StationGroup> station(hubs);
+        for (uint32_t i = 0; i < devices; i++)
+        {
+            station[i % hubs].devices.push_back(profile);
+        }
+        for (auto & group : station)
+        {
+            group.concurrency = static_cast<uint32_t>(number("concurrency", 1));
+            group.bandwidth   = number("hub-bandwidth", 0);
+        }
+
+        double seconds = 0;
+        if (model.predict(station, seconds) != NRFDL_ERR_NONE)
+        {
+            fmt::print(stderr, "Station settings are not valid\n");
+            return EXIT_FAILURE;
+        }
+        fmt::print("Station: {} devices on {} hubs, {:.2f} s\n", devices, hubs, seconds);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include "sdfu_scheduler.h"
+
+#include <algorithm>
+
+namespace NRFDL::SDFU
+{
+    HubScheduler::HubScheduler()
+        : HubScheduler(Config{})
+    {}
+
+    HubScheduler::HubScheduler(const Config & config)
+        : _config(config)
+    {
+        _logger = spdlog::default_logger();
+    }
+
+    auto HubScheduler::groupOf(const std::string & topologyPath) -> std::string
+    {
+        // Strip any leading directories and the interface suffix (":1.0")
+        auto name = topologyPath.substr(topologyPath.find_last_of('/') + 1);
+        name      = name.substr(0, name.find(':'));
+
+        const auto lastPort = name.find_last_of('.');
+        if (lastPort != std::string::npos)
+        {
+            return name.substr(0, lastPort);
+        }
+
+        // Device sits directly on a root hub port, it shares the bus with its siblings
+        return "usb" + name.substr(0, name.find('-'));
+    }
+
+    auto HubScheduler::tryAdmit(const std::string & name, Admission & admission, Clock::time_point now)
+        -> nrfdl_errorcode_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto & g = group(name, now);
+        evaluate(name, g, now);
+
+        if (g.active >= g.limit)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        g.active++;
+        g.peakActive    = std::max(g.peakActive, g.active);
+        admission.group = name;
+        admission.prn   = g.prn;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto HubScheduler::reportProgress(const Admission & admission, uint64_t bytes, Clock::time_point now) -> void
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto & g = group(admission.group, now);
+        g.windowBytes += bytes;
+        evaluate(admission.group, g, now);
+    }
+
+    auto HubScheduler::reportError(const Admission & admission, nrfdl_errorcode_t error, Clock::time_point now) -> void
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto & g = group(admission.group, now);
+        g.windowErrors++;
+        _logger->debug("Session in group {} reported error {}.", admission.group, error);
+        evaluate(admission.group, g, now);
+    }
+
+    auto HubScheduler::release(const Admission & admission, Clock::time_point now) -> void
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto & g = group(admission.group, now);
+        if (g.active > 0)
+        {
+            g.active--;
+        }
+        evaluate(admission.group, g, now);
+    }
+
+    auto HubScheduler::stats(const std::string & name, GroupStats & stats) const -> nrfdl_errorcode_t
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const auto it = _groups.find(name);
+        if (it == _groups.end())
+        {
+            return NRFDL_ERR_ARGUMENT;
+        }
+
+        stats.limit      = it->second.limit;
+        stats.active     = it->second.active;
+        stats.prn        = it->second.prn;
+        stats.throughput = it->second.throughput;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto HubScheduler::group(const std::string & name, Clock::time_point now) -> Group &
+    {
+        auto it = _groups.find(name);
+        if (it == _groups.end())
+        {
+            Group g{};
+            g.limit       = std::clamp(_config.initial_concurrency, _config.min_concurrency, _config.max_concurrency);
+            g.prn         = std::clamp(_config.initial_prn, _config.min_prn, _config.max_prn);
+            g.windowStart = now;
+            g.direction   = 1;
+            it            = _groups.emplace(name, g).first;
+        }
+        return it->second;
+    }
+
+    auto HubScheduler::evaluate(const std::string & name, Group & g, Clock::time_point now) -> void
+    {
+        const auto elapsed = std::chrono::duration<double>(now - g.windowStart).count();
+        if (now - g.windowStart < _config.window || elapsed <= 0)
+        {
+            return;
+        }
+
+        const auto current = static_cast<double>(g.windowBytes) / elapsed;
+        const auto step    = [this](uint32_t limit, int direction) {
+            const auto next = static_cast<int64_t>(limit) + direction;
+            return static_cast<uint32_t>(std::clamp<int64_t>(next, _config.min_concurrency, _config.max_concurrency));
+        };
+
+        if (g.windowErrors > 0)
+        {
+            // Timeouts on a shared hub mean the link is oversubscribed, back off hard
+            g.limit     = std::max(_config.min_concurrency, g.limit / 2);
+            g.prn       = std::max(_config.min_prn, g.prn / 2);
+            g.direction = 1;
+            _logger->warn("Group {}: {} errors, concurrency reduced to {}, PRN to {}.",
+                          name,
+                          g.windowErrors,
+                          g.limit,
+                          g.prn);
+        }
+        else if (g.peakActive > 0)
+        {
+            // Only a saturated group tells us something about its concurrency limit
+            if (g.peakActive >= g.limit)
+            {
+                if (g.throughput <= 0 || current > g.throughput * (1 + _config.tolerance))
+                {
+                    g.limit = step(g.limit, g.direction);
+                }
+                else if (current < g.throughput * (1 - _config.tolerance))
+                {
+                    g.direction = -g.direction;
+                    g.limit     = step(g.limit, g.direction);
+                }
+            }
+
+            g.prn = std::min(_config.max_prn, g.prn * 2);
+        }
+
+        if (g.peakActive > 0 || g.windowBytes > 0)
+        {
+            _logger->debug("Group {}: {:.0f} B/s with {} sessions, limit {}.", name, current, g.peakActive, g.limit);
+            g.throughput = current;
+        }
+
+        g.windowBytes  = 0;
+        g.windowErrors = 0;
+        g.peakActive   = g.active;
+        g.windowStart  = now;
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "nrfdl_types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Admission control for DFU sessions sharing a USB hub or bus.
+     *
+     * Devices behind the same hub compete for the same upstream bandwidth. Starting every session at once makes each
+     * transfer slower and provokes CDC timeouts. The scheduler keeps one controller per group, measures the combined
+     * throughput of the group and hill-climbs the number of concurrent sessions towards the maximum aggregate
+     * throughput. Protocol errors halve both the concurrency limit and the recommended PRN window.
+     */
+    class HubScheduler
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Config
+        {
+            /* Concurrency limit of a newly seen group. */
+            uint32_t initial_concurrency = 2;
+            uint32_t min_concurrency     = 1;
+            uint32_t max_concurrency     = 32;
+            /* PRN window recommended to newly admitted sessions and its bounds. */
+            uint32_t initial_prn = 4;
+            uint32_t min_prn     = 1;
+            uint32_t max_prn     = 64;
+            /* Length of the throughput measurement window. */
+            std::chrono::milliseconds window{1000};
+            /* Relative throughput change treated as noise. */
+            double tolerance = 0.05;
+        };
+
+        /**
+         * @brief Handle for an admitted session. Must be passed to @ref release when the session ends.
+         */
+        struct Admission
+        {
+            std::string group;
+            /* PRN target the session should configure with NRF_DFU_OP_RECEIPT_NOTIF_SET. */
+            uint32_t prn;
+        };
+
+        /**
+         * @brief Snapshot of a group controller.
+         */
+        struct GroupStats
+        {
+            uint32_t limit;
+            uint32_t active;
+            uint32_t prn;
+            /* Aggregate throughput of the last completed window in bytes per second. */
+            double throughput;
+        };
+
+        HubScheduler();
+        explicit HubScheduler(const Config & config);
+
+        /**
+         * @brief Derive the scheduling group from a USB topology path.
+         *
+         * Accepts sysfs style paths such as "1-2.3.4" or "/sys/bus/usb/devices/1-2.3.4:1.0". Devices hanging off the
+         * same hub share the group "1-2.3"; devices directly on a root port share the bus group "usb1".
+         */
+        static auto groupOf(const std::string & topologyPath) -> std::string;
+
+        /**
+         * @brief Try to start a session in the given group.
+         *
+         * @return NRFDL_ERR_NONE if admitted, NRFDL_ERR_RESOURCE_ILLEGAL_STATE if the group is at its limit.
+         */
+        auto tryAdmit(const std::string & group, Admission & admission, Clock::time_point now = Clock::now())
+            -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Account payload bytes acknowledged by the device, typically from a @ref DfuResponseWrite receipt.
+         */
+        auto reportProgress(const Admission & admission, uint64_t bytes, Clock::time_point now = Clock::now())
+            -> void;
+
+        /**
+         * @brief Account a transfer failure such as NRFDL_ERR_PROTOCOL caused by a CDC timeout.
+         */
+        auto reportError(const Admission & admission, nrfdl_errorcode_t error, Clock::time_point now = Clock::now())
+            -> void;
+
+        auto release(const Admission & admission, Clock::time_point now = Clock::now()) -> void;
+
+        auto stats(const std::string & group, GroupStats & stats) const -> nrfdl_errorcode_t;
+
+      private:
+        struct Group
+        {
+            uint32_t limit;
+            uint32_t active;
+            uint32_t peakActive;
+            uint32_t prn;
+            uint64_t windowBytes;
+            uint32_t windowErrors;
+            Clock::time_point windowStart;
+            double throughput;
+            int direction;
+        };
+
+        auto group(const std::string & name, Clock::time_point now) -> Group &;
+        auto evaluate(const std::string & name, Group & group, Clock::time_point now) -> void;
+
+        Config _config;
+        std::map<std::string, Group> _groups;
+        mutable std::mutex _mutex;
+        std::shared_ptr<spdlog::logger> _logger;
+    };
+} // namespace NRFDL::SDFU
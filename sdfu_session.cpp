@@ -0,0 +1,631 @@
+#include "sdfu_session.h"
+#include "sdfu_crc32.h"
+#include "sdfu_frames.h"
+
+#include <algorithm>
+
+namespace NRFDL::SDFU
+{
+    auto writePayloadSize(uint16_t mtu) -> uint16_t
+    {
+        const uint16_t unescaped = (mtu > 0) ? (mtu - 1) / 2 : 0;
+        return (unescaped > Frames::writeOverhead) ? unescaped - Frames::writeOverhead : 0;
+    }
+
+    Session::Session(const data_t & init, const data_t & firmware)
+        : Session(init, firmware, Config{})
+    {}
+
+    Session::Session(const data_t & init, const data_t & firmware, const Config & config)
+        : Session(init, nullptr, std::make_unique<MemoryImageSource>(firmware), config)
+    {}
+
+    Session::Session(const data_t & init, ImageSource & firmware)
+        : Session(init, firmware, Config{})
+    {}
+
+    Session::Session(const data_t & init, ImageSource & firmware, const Config & config)
+        : Session(init, &firmware, nullptr, config)
+    {}
+
+    Session::Session(const data_t & init,
+                     ImageSource * firmware,
+                     std::unique_ptr<ImageSource> ownedFirmware,
+                     const Config & config)
+        : _init(init)
+        , _ownedFirmware(std::move(ownedFirmware))
+        , _firmware(firmware ? *firmware : *_ownedFirmware)
+        , _config(config)
+        , _state(State::ReceiptNotifSet)
+        , _awaiting(DfuOpcode::NRF_DFU_OP_INVALID)
+        , _resumeExecute(false)
+        , _chunk(0)
+        , _maxSize(0)
+        , _offset(0)
+        , _crc(0)
+        , _objectStart(0)
+        , _objectEnd(0)
+        , _objectCrc(0)
+        , _prnCount(0)
+        , _retries(0)
+        , _window(nullptr)
+        , _windowStart(0)
+        , _windowEnd(0)
+        , _frames(nullptr)
+        , _windowCrc(0)
+        , _windowCrcKnown(false)
+        , _hashed(0)
+        , _arenaBuffer(config.memory ? config.memory : std::pmr::get_default_resource())
+    {
+        _arena.emplace(_arenaBuffer.get_allocator().resource());
+        _logger = spdlog::default_logger();
+    }
+
+    auto Session::next(DfuRequest & request) -> nrfdl_errorcode_t
+    {
+        if (_awaiting != DfuOpcode::NRF_DFU_OP_INVALID || _state == State::Done || _state == State::Failed)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        switch (_state)
+        {
+            case State::ReceiptNotifSet:
+            case State::DataReceiptNotifSet:
+                request.opcode  = DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET;
+                request.request = DfuRequestPrn{_config.prn};
+                break;
+
+            case State::MtuGet:
+                request.opcode  = DfuOpcode::NRF_DFU_OP_MTU_GET;
+                request.request = DfuRequestMtu{_config.mtu};
+                break;
+
+            case State::CommandSelect:
+            case State::DataSelect:
+                request.opcode  = DfuOpcode::NRF_DFU_OP_OBJECT_SELECT;
+                request.request = DfuRequestSelect{static_cast<uint32_t>(objectType())};
+                break;
+
+            case State::CommandCreate:
+            case State::DataCreate:
+            {
+                const auto size = std::min<uint32_t>(_maxSize, imageSize() - _objectStart);
+
+                _objectEnd      = _objectStart + size;
+                _objectCrc      = _crc;
+                _offset         = _objectStart;
+                request.opcode  = DfuOpcode::NRF_DFU_OP_OBJECT_CREATE;
+                request.request = DfuRequestCreate{static_cast<uint32_t>(objectType()), size};
+                resetArena(size);
+                break;
+            }
+
+            case State::CommandWrite:
+            case State::DataWrite:
+            {
+                const uint8_t * payload = nullptr;
+                uint16_t size           = 0;
+                const auto error        = write(payload, size);
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+
+                DfuRequestWrite details(&*_arena);
+                details.data.assign(payload, payload + size);
+                details.len = size;
+
+                request.opcode  = DfuOpcode::NRF_DFU_OP_OBJECT_WRITE;
+                request.request = std::move(details);
+                return NRFDL_ERR_NONE;
+            }
+
+            case State::CommandCrc:
+            case State::DataCrc:
+                request.opcode = DfuOpcode::NRF_DFU_OP_CRC_GET;
+                request.request.reset();
+                break;
+
+            case State::CommandExecute:
+            case State::DataExecute:
+                request.opcode = DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE;
+                request.request.reset();
+                break;
+
+            case State::Done:
+            case State::Failed:
+                return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        _awaiting = request.opcode;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::nextBatch(FrameBatch & batch) -> nrfdl_errorcode_t
+    {
+        if (_awaiting != DfuOpcode::NRF_DFU_OP_INVALID || _state == State::Done || _state == State::Failed)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        DfuRequest request;
+        while (_awaiting == DfuOpcode::NRF_DFU_OP_INVALID && _state != State::Done && _state != State::Failed)
+        {
+            if (_state == State::CommandWrite || _state == State::DataWrite)
+            {
+                const auto data         = _state == State::DataWrite;
+                const auto start        = _offset;
+                const uint8_t * payload = nullptr;
+                uint16_t size           = 0;
+                auto error              = write(payload, size);
+
+                // Pre-encoded frames of the source follow each other one chunk apart
+                if (error == NRFDL_ERR_NONE && data && _frames != nullptr && (start - _windowStart) % _chunk == 0)
+                {
+                    const auto frame = (start - _windowStart) / _chunk * (_chunk + Frames::writeOverhead);
+                    error            = batch.addEncoded(_frames + frame, size + Frames::writeOverhead);
+                }
+                else if (error == NRFDL_ERR_NONE)
+                {
+                    error = batch.addWrite(payload, size);
+                }
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+                continue;
+            }
+
+            auto error = next(request);
+            if (error == NRFDL_ERR_NONE)
+            {
+                error = batch.add(request);
+            }
+            if (error != NRFDL_ERR_NONE)
+            {
+                return error;
+            }
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::handle(const DfuResponse & response) -> nrfdl_errorcode_t
+    {
+        if (_awaiting == DfuOpcode::NRF_DFU_OP_INVALID || response.opcode != _awaiting)
+        {
+            return fail("unexpected response");
+        }
+
+        const auto expected = _awaiting;
+        _awaiting           = DfuOpcode::NRF_DFU_OP_INVALID;
+
+        if (response.result != DfuResult::NRF_DFU_RES_CODE_SUCCESS)
+        {
+            // Executing an object that was already executed before the transfer got interrupted
+            const auto reExecuted = expected == DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE && _resumeExecute &&
+                                    response.result == DfuResult::NRF_DFU_RES_CODE_OPERATION_NOT_PERMITTED;
+            if (!reExecuted)
+            {
+                _logger->error("Request {:#04x} failed with result {:#04x}.",
+                               static_cast<uint8_t>(expected),
+                               static_cast<uint8_t>(response.result));
+                return fail("request failed");
+            }
+        }
+
+        switch (expected)
+        {
+            case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                _state = (_state == State::ReceiptNotifSet) ? State::MtuGet : State::DataWrite;
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_MTU_GET:
+            {
+                const auto mtu = response.response ? std::get_if<DfuResponseMtu>(&*response.response) : nullptr;
+                if (mtu == nullptr)
+                {
+                    return fail("missing MTU");
+                }
+
+                _chunk = writePayloadSize(std::min(mtu->size, _config.mtu));
+                if (_chunk == 0)
+                {
+                    return fail("MTU too small");
+                }
+                _state = _init.empty() ? State::DataSelect : State::CommandSelect;
+                break;
+            }
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+            {
+                const auto select = response.response ? std::get_if<DfuResponseSelect>(&*response.response) : nullptr;
+                if (select == nullptr || select->max_size == 0)
+                {
+                    return fail("invalid select response");
+                }
+
+                _maxSize = select->max_size;
+                if (_state == State::CommandSelect)
+                {
+                    if (_init.size() > _maxSize)
+                    {
+                        return fail("init packet does not fit the command object");
+                    }
+
+                    // The init packet is small, always send it again
+                    _objectStart = 0;
+                    _crc         = 0;
+                    _state       = State::CommandCreate;
+                }
+                else
+                {
+                    const auto error = resume(*select);
+                    if (error != NRFDL_ERR_NONE)
+                    {
+                        return error;
+                    }
+                }
+                break;
+            }
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                _prnCount = 0;
+                _state    = (_state == State::CommandCreate) ? State::CommandWrite : State::DataWrite;
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+            {
+                const auto receipt = response.response ? std::get_if<DfuResponseWrite>(&*response.response) : nullptr;
+                if (receipt == nullptr || receipt->offset != _offset || receipt->crc != _crc)
+                {
+                    return retry("receipt mismatch");
+                }
+                break;
+            }
+
+            case DfuOpcode::NRF_DFU_OP_CRC_GET:
+            {
+                const auto crc = response.response ? std::get_if<DfuResponseCrc>(&*response.response) : nullptr;
+                if (crc == nullptr || crc->offset != _offset || crc->crc != _crc)
+                {
+                    return retry("CRC mismatch");
+                }
+                _state = (_state == State::CommandCrc) ? State::CommandExecute : State::DataExecute;
+                break;
+            }
+
+            case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                _retries       = 0;
+                _resumeExecute = false;
+                if (_state == State::CommandExecute)
+                {
+                    _offset = 0;
+                    _state  = (_firmware.size() == 0) ? State::Done : State::DataSelect;
+                }
+                else if (_offset == _firmware.size())
+                {
+                    _logger->debug("Transferred {} bytes.", _offset);
+                    _state = State::Done;
+                }
+                else
+                {
+                    _objectStart = _offset;
+                    _state       = State::DataCreate;
+                }
+                break;
+
+            case DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION:
+            case DfuOpcode::NRF_DFU_OP_PING:
+            case DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION:
+            case DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION:
+            case DfuOpcode::NRF_DFU_OP_ABORT:
+            case DfuOpcode::NRF_DFU_OP_RESPONSE:
+            case DfuOpcode::NRF_DFU_OP_INVALID:
+                return fail("unexpected response");
+        }
+
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::timeout() -> nrfdl_errorcode_t
+    {
+        if (_awaiting == DfuOpcode::NRF_DFU_OP_INVALID)
+        {
+            return NRFDL_ERR_RESOURCE_ILLEGAL_STATE;
+        }
+
+        // Writes of the window might be lost as well, start the object over
+        if (_awaiting == DfuOpcode::NRF_DFU_OP_OBJECT_WRITE)
+        {
+            return retry("receipt timeout");
+        }
+
+        if (++_retries > _config.max_retries)
+        {
+            return fail("response timeout");
+        }
+
+        _logger->warn("Response to {:#04x} timed out, sending the request again.", static_cast<uint8_t>(_awaiting));
+
+        // Only the response might have been lost, the object is then executed already
+        _resumeExecute = _resumeExecute || _awaiting == DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE;
+        _awaiting      = DfuOpcode::NRF_DFU_OP_INVALID;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::awaitingResponse() const -> bool
+    {
+        return _awaiting != DfuOpcode::NRF_DFU_OP_INVALID;
+    }
+
+    auto Session::awaiting() const -> DfuOpcode
+    {
+        return _awaiting;
+    }
+
+    auto Session::state() const -> State
+    {
+        return _state;
+    }
+
+    auto Session::done() const -> bool
+    {
+        return _state == State::Done;
+    }
+
+    auto Session::failed() const -> bool
+    {
+        return _state == State::Failed;
+    }
+
+    auto Session::offset() const -> uint32_t
+    {
+        return _offset;
+    }
+
+    auto Session::objectSize() const -> uint32_t
+    {
+        return _maxSize;
+    }
+
+    auto Session::chunkSize() const -> uint16_t
+    {
+        return _chunk;
+    }
+
+    auto Session::imageSize() const -> uint32_t
+    {
+        return (_state <= State::CommandExecute) ? static_cast<uint32_t>(_init.size()) : _firmware.size();
+    }
+
+    auto Session::objectType() const -> DfuObjecType
+    {
+        return (_state <= State::CommandExecute) ? DfuObjecType::NRF_DFU_OBJ_TYPE_COMMAND
+                                                 : DfuObjecType::NRF_DFU_OBJ_TYPE_DATA;
+    }
+
+    auto Session::resume(const DfuResponseSelect & select) -> nrfdl_errorcode_t
+    {
+        _objectStart = 0;
+        _offset      = 0;
+        _crc         = 0;
+        _state       = State::DataCreate;
+
+        if (select.offset == 0 || select.offset > _firmware.size())
+        {
+            return NRFDL_ERR_NONE;
+        }
+
+        // Start of the object holding the offset, of the previous one if the offset ends an object
+        const auto remainder = select.offset % _maxSize;
+        const auto rewind    = select.offset - (remainder ? remainder : std::min(_maxSize, select.offset));
+
+        uint32_t rewindCrc = 0;
+        uint32_t expected  = 0;
+        const auto error   = prefix(select.offset, rewind, rewindCrc, expected);
+        if (error != NRFDL_ERR_NONE)
+        {
+            return error;
+        }
+
+        if (expected != select.crc)
+        {
+            // Rewind to the start of the object holding the bad data
+            _objectStart = rewind;
+            _crc         = rewindCrc;
+            _logger->info("Resume CRC mismatch at {}, restarting from {}.", select.offset, _objectStart);
+            return NRFDL_ERR_NONE;
+        }
+
+        _offset      = select.offset;
+        _crc         = expected;
+        _objectStart = select.offset - remainder;
+        _objectCrc   = remainder ? rewindCrc : expected;
+
+        if (remainder == 0 || select.offset == _firmware.size())
+        {
+            // Object is complete, it might not have been executed yet
+            _resumeExecute = true;
+            _state         = State::DataExecute;
+        }
+        else
+        {
+            _objectEnd = std::min<uint32_t>(_objectStart + _maxSize, _firmware.size());
+            _prnCount  = 0;
+            _state     = (_config.prn > 0) ? State::DataReceiptNotifSet : State::DataWrite;
+        }
+        _logger->info("Resuming transfer at {}.", select.offset);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::prefix(uint32_t end, uint32_t mark, uint32_t & markCrc, uint32_t & crc) -> nrfdl_errorcode_t
+    {
+        markCrc = 0;
+        crc     = 0;
+        _window = nullptr;
+        _frames = nullptr;
+
+        // Windows are aligned to objects, so the last one is the object the transfer resumes in
+        for (uint32_t position = 0; position < end;)
+        {
+            const auto size = std::min(_maxSize, end - position);
+            if (position == mark)
+            {
+                markCrc = crc;
+            }
+
+            // Without a hash to check the bytes are not needed if the source knows their CRC
+            if (!_config.sha256 && _firmware.crc(position, size, crc))
+            {
+                position += size;
+                continue;
+            }
+
+            const uint8_t * data = nullptr;
+            const auto error     = _firmware.read(position, size, data);
+            if (error != NRFDL_ERR_NONE)
+            {
+                _logger->error("Reading the firmware at {} failed with {}.", position, error);
+                return fail("firmware read failed");
+            }
+            if (!verify(data, position, size))
+            {
+                return fail("firmware does not match the init packet hash");
+            }
+
+            crc = crc32(data, size, crc);
+            position += size;
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::load() -> nrfdl_errorcode_t
+    {
+        if (_window != nullptr && _objectStart >= _windowStart && _objectEnd <= _windowEnd)
+        {
+            return NRFDL_ERR_NONE;
+        }
+
+        _window          = nullptr;
+        _frames          = nullptr;
+        _windowCrcKnown  = false;
+        const auto error = _firmware.read(_objectStart, _objectEnd - _objectStart, _window);
+        if (error != NRFDL_ERR_NONE)
+        {
+            _window = nullptr;
+            _logger->error("Reading the firmware at {} failed with {}.", _objectStart, error);
+            return fail("firmware read failed");
+        }
+        _windowStart = _objectStart;
+        _windowEnd   = _objectEnd;
+        _frames      = _firmware.frames(_objectStart, _objectEnd - _objectStart, _chunk);
+
+        // Objects of a store are CRC'd once for all sessions, receipts still need the CRC after each write
+        _windowCrc      = _objectCrc;
+        _windowCrcKnown = _config.prn == 0 && _firmware.crc(_objectStart, _objectEnd - _objectStart, _windowCrc);
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::write(const uint8_t *& payload, uint16_t & size) -> nrfdl_errorcode_t
+    {
+        if (_state == State::CommandWrite)
+        {
+            payload = _init.data() + _offset;
+        }
+        else
+        {
+            const auto error = load();
+            if (error != NRFDL_ERR_NONE)
+            {
+                return error;
+            }
+            payload = _window + (_offset - _windowStart);
+        }
+        size = static_cast<uint16_t>(std::min<uint32_t>(_chunk, _objectEnd - _offset));
+
+        const auto known = _state == State::DataWrite && _windowCrcKnown;
+        if (!known)
+        {
+            _crc = crc32(payload, size, _crc);
+        }
+        if (_state == State::DataWrite && !verify(payload, _offset, size))
+        {
+            return fail("firmware does not match the init packet hash");
+        }
+        _offset += size;
+        if (known && _offset == _windowEnd)
+        {
+            _crc = _windowCrc;
+        }
+
+        if (_config.prn > 0 && ++_prnCount == _config.prn)
+        {
+            _prnCount = 0;
+            _awaiting = DfuOpcode::NRF_DFU_OP_OBJECT_WRITE;
+        }
+
+        if (_offset == _objectEnd)
+        {
+            _state = (_state == State::CommandWrite) ? State::CommandCrc : State::DataCrc;
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::verify(const uint8_t * data, uint32_t offset, uint32_t size) -> bool
+    {
+        if (!_config.sha256)
+        {
+            return true;
+        }
+
+        // Bytes sent again after a retry were hashed the first time
+        const auto end = offset + size;
+        if (end > _hashed)
+        {
+            _hash.update(data + (_hashed - offset), end - _hashed);
+            _hashed = end;
+
+            if (_hashed == _firmware.size() && _hash.final() != *_config.sha256)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    auto Session::resetArena(uint32_t size) -> void
+    {
+        // Payloads are allocated at their exact size, so the writes of one object fill at most the object size
+        constexpr size_t minimumSize = 4096;
+        if (_arenaBuffer.size() < size)
+        {
+            _arena.reset();
+            _arenaBuffer.resize(std::max<size_t>(size, minimumSize));
+        }
+        _arena.emplace(_arenaBuffer.data(), _arenaBuffer.size(), _arenaBuffer.get_allocator().resource());
+    }
+
+    auto Session::retry(const char * reason) -> nrfdl_errorcode_t
+    {
+        if (++_retries > _config.max_retries)
+        {
+            return fail(reason);
+        }
+
+        _logger->warn("Object at {}: {}, retrying.", _objectStart, reason);
+        _offset   = _objectStart;
+        _crc      = _objectCrc;
+        _awaiting = DfuOpcode::NRF_DFU_OP_INVALID;
+        _state    = (_state <= State::CommandExecute) ? State::CommandCreate : State::DataCreate;
+        return NRFDL_ERR_NONE;
+    }
+
+    auto Session::fail(const char * reason) -> nrfdl_errorcode_t
+    {
+        _logger->error("DFU session failed: {}.", reason);
+        _awaiting = DfuOpcode::NRF_DFU_OP_INVALID;
+        _state    = State::Failed;
+        return NRFDL_ERR_PROTOCOL;
+    }
+} // namespace NRFDL::SDFU
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "nrfdl_types.h"
+#include "sdfu_batch.h"
+#include "sdfu_codec.h"
+#include "sdfu_image_source.h"
+#include "sdfu_sha256.h"
+#include "sdfu_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#include <spdlog/spdlog.h>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Largest @ref NRF_DFU_OP_OBJECT_WRITE payload that fits a transport MTU.
+     *
+     * The serial transport SLIP encodes frames, which in the worst case doubles every byte. Besides the payload the
+     * write frame carries the opcode and the trailing 16 bit length.
+     */
+    auto writePayloadSize(uint16_t mtu) -> uint16_t;
+
+    /**
+     * @brief Host side state machine of a Secure DFU transfer.
+     *
+     * Sends the init packet as command object and the firmware as a sequence of data objects, resuming an
+     * interrupted transfer where the bootloader reports valid data. The session does no I/O: the caller sends the
+     * request produced by @ref next and feeds every response back through @ref handle.
+     *
+     * The firmware is read from an @ref ImageSource one object at a time, so a session holds no more of the image
+     * than the object size of the bootloader. Resuming reads the image up to the offset reported once, front to back.
+     *
+     * Write payloads are allocated from a monotonic arena of the session that holds one object and is reset when the
+     * next object is created, so a transfer takes memory from the upstream resource about once. A request produced
+     * by @ref next must not be kept past the next object or outlive the session.
+     */
+    class Session
+    {
+      public:
+        enum class State : uint8_t
+        {
+            ReceiptNotifSet,
+            MtuGet,
+            CommandSelect,
+            CommandCreate,
+            CommandWrite,
+            CommandCrc,
+            CommandExecute,
+            DataSelect,
+            /* Resuming inside an object, the bootloader counts receipts from the last create or PRN request. */
+            DataReceiptNotifSet,
+            DataCreate,
+            DataWrite,
+            DataCrc,
+            DataExecute,
+            Done,
+            Failed,
+        };
+
+        struct Config
+        {
+            /* Receipt notification interval in write requests, 0 disables receipts. */
+            uint32_t prn = 0;
+            /* Largest frame the host is able to send. */
+            uint16_t mtu = 1024;
+            /* Attempts to re-create an object after a CRC mismatch. */
+            uint32_t max_retries = 3;
+            /* SHA-256 of the firmware from the init packet. The image is hashed as it is sent and the session fails
+               before the last write if it does not match. */
+            std::optional<Sha256Digest> sha256;
+            /* Upstream of the session arena, nullptr uses the default memory resource. */
+            std::pmr::memory_resource * memory = nullptr;
+        };
+
+        Session(const data_t & init, const data_t & firmware);
+        Session(const data_t & init, const data_t & firmware, const Config & config);
+        /* The source must outlive the session. */
+        Session(const data_t & init, ImageSource & firmware);
+        Session(const data_t & init, ImageSource & firmware, const Config & config);
+
+        /**
+         * @brief Produce the next request to send.
+         *
+         * @return NRFDL_ERR_RESOURCE_ILLEGAL_STATE while a response is outstanding or the session has ended.
+         */
+        auto next(DfuRequest & request) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Append requests to @p batch until one of them expects a response.
+         *
+         * Write payloads point into the window of the current object, they stay valid until the next object is
+         * created. Writes the source has pre-encoded are added as they are. Without receipts a whole object and its
+         * CRC request go out in one batch, with receipts one receipt window.
+         *
+         * @return NRFDL_ERR_RESOURCE_ILLEGAL_STATE while a response is outstanding or the session has ended.
+         */
+        auto nextBatch(FrameBatch & batch) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief Consume a response from the bootloader.
+         *
+         * @return NRFDL_ERR_PROTOCOL if the response is unexpected or reports a failure, the session is failed then.
+         */
+        auto handle(const DfuResponse & response) -> nrfdl_errorcode_t;
+
+        /**
+         * @brief The response awaited got lost, typically reported by @ref RequestTimers.
+         *
+         * A lost receipt restarts the current object. Other requests are sent again by the next call to @ref next.
+         * Both count as a retry of the object. A late response to the original request has to be dropped by the
+         * transport.
+         *
+         * @return NRFDL_ERR_RESOURCE_ILLEGAL_STATE if no response is awaited, NRFDL_ERR_PROTOCOL once the retries are
+         * exhausted, the session is failed then.
+         */
+        auto timeout() -> nrfdl_errorcode_t;
+
+        auto awaitingResponse() const -> bool;
+        /* Opcode of the outstanding response, NRF_DFU_OP_INVALID if none. */
+        auto awaiting() const -> DfuOpcode;
+        auto state() const -> State;
+        auto done() const -> bool;
+        auto failed() const -> bool;
+
+        /* Bytes of the current image sent so far. */
+        auto offset() const -> uint32_t;
+        /* Object size reported by the bootloader for the current object type. */
+        auto objectSize() const -> uint32_t;
+        /* Payload bytes per @ref NRF_DFU_OP_OBJECT_WRITE request. */
+        auto chunkSize() const -> uint16_t;
+
+      private:
+        Session(const data_t & init,
+                ImageSource * firmware,
+                std::unique_ptr<ImageSource> ownedFirmware,
+                const Config & config);
+
+        auto imageSize() const -> uint32_t;
+        auto objectType() const -> DfuObjecType;
+        auto resume(const DfuResponseSelect & select) -> nrfdl_errorcode_t;
+        /* Read the firmware up to @p end one object at a time, hashing it and taking the CRC at the object start
+           @p mark on the way. */
+        auto prefix(uint32_t end, uint32_t mark, uint32_t & markCrc, uint32_t & crc) -> nrfdl_errorcode_t;
+        /* Read the current data object from the firmware source unless it is in the window already. */
+        auto load() -> nrfdl_errorcode_t;
+        /* Advance over the next write of the current object, its payload stays in the init packet or the window. */
+        auto write(const uint8_t *& payload, uint16_t & size) -> nrfdl_errorcode_t;
+        auto verify(const uint8_t * data, uint32_t offset, uint32_t size) -> bool;
+        auto resetArena(uint32_t size) -> void;
+        auto retry(const char * reason) -> nrfdl_errorcode_t;
+        auto fail(const char * reason) -> nrfdl_errorcode_t;
+
+        const data_t & _init;
+        /* Wraps the firmware passed as vector. */
+        std::unique_ptr<ImageSource> _ownedFirmware;
+        ImageSource & _firmware;
+        Config _config;
+
+        State _state;
+        DfuOpcode _awaiting;
+        bool _resumeExecute;
+
+        uint16_t _chunk;
+        uint32_t _maxSize;
+        uint32_t _offset;
+        uint32_t _crc;
+        uint32_t _objectStart;
+        uint32_t _objectEnd;
+        uint32_t _objectCrc;
+        uint32_t _prnCount;
+        uint32_t _retries;
+
+        /* Firmware window of the current data object. */
+        const uint8_t * _window;
+        uint32_t _windowStart;
+        uint32_t _windowEnd;
+        /* Pre-encoded writes of the window, if the source has them. */
+        const uint8_t * _frames;
+        /* CRC at the end of the window as known by the source, the writes skip their own CRC then. */
+        uint32_t _windowCrc;
+        bool _windowCrcKnown;
+
+        Sha256 _hash;
+        uint32_t _hashed;
+
+        /* Backing store of the arena, grown to the largest object once. */
+        std::pmr::vector<std::byte> _arenaBuffer;
+        std::optional<std::pmr::monotonic_buffer_resource> _arena;
+
+        std::shared_ptr<spdlog::logger> _logger;
+    };
+} // namespace NRFDL::SDFU
@@ -0,0 +1,263 @@
+#include "sdfu_sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define SDFU_SHA256_SHANI
+#endif
+
+namespace NRFDL::SDFU
+{
+    namespace
+    {
+        using Compress = void (*)(uint32_t * state, const uint8_t * data, size_t blocks);
+
+        alignas(16) constexpr uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+
+        inline auto rotr(uint32_t x, int n) -> uint32_t
+        {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        auto compressPortable(uint32_t * state, const uint8_t * data, size_t blocks) -> void
+        {
+            uint32_t w[64];
+
+            for (; blocks > 0; blocks--, data += 64)
+            {
+                for (int i = 0; i < 16; i++)
+                {
+                    w[i] = (static_cast<uint32_t>(data[4 * i]) << 24) | (data[4 * i + 1] << 16) |
+                           (data[4 * i + 2] << 8) | data[4 * i + 3];
+                }
+
+                for (int i = 16; i < 64; i++)
+                {
+                    const auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    const auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i]          = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                auto a = state[0];
+                auto b = state[1];
+                auto c = state[2];
+                auto d = state[3];
+                auto e = state[4];
+                auto f = state[5];
+                auto g = state[6];
+                auto h = state[7];
+
+                for (int i = 0; i < 64; i++)
+                {
+                    const auto t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+                    const auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                state[0] += a;
+                state[1] += b;
+                state[2] += c;
+                state[3] += d;
+                state[4] += e;
+                state[5] += f;
+                state[6] += g;
+                state[7] += h;
+            }
+        }
+
+#if defined(SDFU_SHA256_SHANI)
+        __attribute__((target("sha,ssse3,sse4.1"))) auto compressShaNi(uint32_t * state,
+                                                                        const uint8_t * data,
+                                                                        size_t blocks) -> void
+        {
+            const auto mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+            // The instructions keep the state as ABEF and CDGH
+            auto tmp    = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xb1);
+            auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1b);
+            auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+            state1      = _mm_blend_epi16(state1, tmp, 0xf0);
+
+            for (; blocks > 0; blocks--, data += 64)
+            {
+                const auto abef = state0;
+                const auto cdgh = state1;
+                __m128i w[4];
+
+                // Four rounds per step, w[i % 4] holds the message words of step i
+#pragma GCC unroll 16
+                for (int i = 0; i < 16; i++)
+                {
+                    auto & current  = w[i % 4];
+                    auto & next     = w[(i + 1) % 4];
+                    auto & previous = w[(i + 3) % 4];
+
+                    if (i < 4)
+                    {
+                        current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)),
+                                                   mask);
+                    }
+
+                    auto msg = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i *>(k + 4 * i)));
+                    state1   = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+                    if (i >= 3 && i < 15)
+                    {
+                        const auto sum = _mm_add_epi32(next, _mm_alignr_epi8(current, previous, 4));
+                        next           = _mm_sha256msg2_epu32(sum, current);
+                    }
+
+                    msg    = _mm_shuffle_epi32(msg, 0x0e);
+                    state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+                    if (i >= 1 && i < 13)
+                    {
+                        previous = _mm_sha256msg1_epu32(previous, current);
+                    }
+                }
+
+                state0 = _mm_add_epi32(state0, abef);
+                state1 = _mm_add_epi32(state1, cdgh);
+            }
+
+            tmp    = _mm_shuffle_epi32(state0, 0x1b);
+            state1 = _mm_shuffle_epi32(state1, 0xb1);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(tmp, state1, 0xf0));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+        }
+
+        auto hasShaNi() -> bool
+        {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3))
+            {
+                return false;
+            }
+            if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+            {
+                return false;
+            }
+            return (ebx & (1u << 29)) != 0;
+        }
+#endif
+
+        auto selectCompress() -> Compress
+        {
+#if defined(SDFU_SHA256_SHANI)
+            if (hasShaNi())
+            {
+                return compressShaNi;
+            }
+#endif
+            return compressPortable;
+        }
+
+        // Resolved on first use so hashing during static initialization of other units works
+        auto compress(uint32_t * state, const uint8_t * data, size_t blocks) -> void
+        {
+            static const Compress function = selectCompress();
+            function(state, data, blocks);
+        }
+    } // namespace
+
+    Sha256::Sha256()
+    {
+        reset();
+    }
+
+    auto Sha256::reset() -> void
+    {
+        _state    = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        _buffered = 0;
+        _length   = 0;
+    }
+
+    auto Sha256::update(const uint8_t * data, size_t size) -> void
+    {
+        _length += size;
+
+        if (_buffered > 0)
+        {
+            const auto take = std::min(size, _buffer.size() - _buffered);
+            std::memcpy(_buffer.data() + _buffered, data, take);
+            _buffered += take;
+            data += take;
+            size -= take;
+
+            if (_buffered < _buffer.size())
+            {
+                return;
+            }
+            compress(_state.data(), _buffer.data(), 1);
+            _buffered = 0;
+        }
+
+        const auto blocks = size / 64;
+        if (blocks > 0)
+        {
+            compress(_state.data(), data, blocks);
+            data += blocks * 64;
+            size -= blocks * 64;
+        }
+
+        std::memcpy(_buffer.data(), data, size);
+        _buffered = size;
+    }
+
+    auto Sha256::final() -> Sha256Digest
+    {
+        const auto bits = _length * 8;
+
+        // Padding is a one bit, zeros up to 56 mod 64 and the length in bits
+        uint8_t padding[72] = {0x80};
+        const auto zeros    = (_buffered < 56) ? 56 - _buffered : 120 - _buffered;
+        for (int i = 0; i < 8; i++)
+        {
+            padding[zeros + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        }
+        update(padding, zeros + 8);
+
+        Sha256Digest digest;
+        for (size_t i = 0; i < _state.size(); i++)
+        {
+            digest[4 * i]     = static_cast<uint8_t>(_state[i] >> 24);
+            digest[4 * i + 1] = static_cast<uint8_t>(_state[i] >> 16);
+            digest[4 * i + 2] = static_cast<uint8_t>(_state[i] >> 8);
+            digest[4 * i + 3] = static_cast<uint8_t>(_state[i]);
+        }
+        return digest;
+    }
+
+    auto Sha256::accelerated() -> bool
+    {
+        static const bool shaNi = selectCompress() != compressPortable;
+        return shaNi;
+    }
+
+    auto sha256(const uint8_t * data, size_t size) -> Sha256Digest
+    {
+        Sha256 hash;
+        hash.update(data, size);
+        return hash.final();
+    }
+} // namespace NRFDL::SDFU
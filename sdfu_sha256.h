@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace NRFDL::SDFU
+{
+    using Sha256Digest = std::array<uint8_t, 32>;
+
+    /**
+     * @brief Incremental SHA-256 as carried by the Secure DFU init packet for the firmware image.
+     *
+     * Blocks are compressed with the SHA extensions when the CPU has them, with a portable implementation otherwise.
+     */
+    class Sha256
+    {
+      public:
+        Sha256();
+
+        auto reset() -> void;
+        auto update(const uint8_t * data, size_t size) -> void;
+        /* Digest of everything passed to @ref update, the state has to be reset before it is used again. */
+        auto final() -> Sha256Digest;
+
+        /* True if blocks are compressed with the SHA extensions. */
+        static auto accelerated() -> bool;
+
+      private:
+        std::array<uint32_t, 8> _state;
+        std::array<uint8_t, 64> _buffer;
+        size_t _buffered;
+        uint64_t _length;
+    };
+
+    auto sha256(const uint8_t * data, size_t size) -> Sha256Digest;
+} // namespace NRFDL::SDFU
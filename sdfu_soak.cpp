@@ -0,0 +1,484 @@
+/*
+ * Soak and throughput regression harness.
+ *
+ * Runs randomized complete updates through the real Codec against the simulated bootloader: image and init packet
+ * sizes, MTU and PRN vary per update, request and response frames are dropped and write payloads corrupted at the
+ * given rates. A lost frame the host waits for times out on a simulated clock and the request is sent again; once a
+ * session runs out of retries a new one resumes the transfer, as the host tool does. Every update must end with the
+ * device holding the image.
+ *
+ * Reports throughput, per opcode request latency percentiles and peak RSS. With --baseline the run fails if
+ * throughput dropped, a p99 latency or the peak RSS grew by more than the tolerance; --write-baseline stores the
+ * results of the run.
+ */
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_codec.h"
+#include "sdfu_session.h"
+#include "sdfu_timer.h"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Latency histogram with buckets growing by 2^(1/8), memory stays constant however long the soak runs.
+     */
+    class Histogram
+    {
+      public:
+        auto add(uint64_t ns) -> void
+        {
+            _counts[bucket(ns)]++;
+            _total++;
+        }
+
+        auto total() const -> uint64_t
+        {
+            return _total;
+        }
+
+        /* Upper bound of the bucket holding the given fraction of samples, in nanoseconds. */
+        auto percentile(double fraction) const -> uint64_t
+        {
+            const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(_total));
+            uint64_t seen   = 0;
+            for (size_t i = 0; i < _counts.size(); i++)
+            {
+                seen += _counts[i];
+                if (seen > rank)
+                {
+                    return upper(i);
+                }
+            }
+            return 0;
+        }
+
+      private:
+        static constexpr size_t steps = 8;
+
+        static auto bucket(uint64_t ns) -> size_t
+        {
+            if (ns < steps)
+            {
+                return static_cast<size_t>(ns);
+            }
+
+            size_t exponent = 0;
+            for (auto v = ns; v >>= 1;)
+            {
+                exponent++;
+            }
+            const auto step = (ns >> (exponent - 3)) & (steps - 1);
+            return (exponent - 2) * steps + static_cast<size_t>(step);
+        }
+
+        static auto upper(size_t index) -> uint64_t
+        {
+            if (index < steps)
+            {
+                return index;
+            }
+
+            const auto exponent = index / steps + 2;
+            const auto step     = index % steps;
+            return ((steps + step + 1) << exponent) / steps - 1;
+        }
+
+        std::array<uint64_t, 64 * steps> _counts{};
+        uint64_t _total = 0;
+    };
+
+    struct Results
+    {
+        uint64_t updates  = 0;
+        uint64_t failures = 0;
+        uint64_t resumes  = 0;
+        uint64_t timeouts = 0;
+        uint64_t drops    = 0;
+        uint64_t corrupts = 0;
+        uint64_t bytes    = 0;
+        double seconds    = 0;
+        uint64_t peak_rss = 0;
+        std::map<DfuOpcode, Histogram> latency;
+
+        auto throughput() const -> double
+        {
+            return seconds > 0 ? static_cast<double>(bytes) / seconds : 0;
+        }
+    };
+
+    auto peakRss() -> uint64_t
+    {
+#if !defined(_WIN32)
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+        {
+#if defined(__APPLE__)
+            return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+            return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+        }
+#endif
+        return 0;
+    }
+
+    auto opcodeName(DfuOpcode opcode) -> std::string
+    {
+        switch (opcode)
+        {
+            case DfuOpcode::NRF_DFU_OP_OBJECT_CREATE:
+                return "create";
+            case DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET:
+                return "prn";
+            case DfuOpcode::NRF_DFU_OP_CRC_GET:
+                return "crc";
+            case DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE:
+                return "execute";
+            case DfuOpcode::NRF_DFU_OP_OBJECT_SELECT:
+                return "select";
+            case DfuOpcode::NRF_DFU_OP_MTU_GET:
+                return "mtu";
+            case DfuOpcode::NRF_DFU_OP_OBJECT_WRITE:
+                return "write";
+            default:
+                return fmt::format("op{:02x}", static_cast<uint8_t>(opcode));
+        }
+    }
+
+    class Soak
+    {
+      public:
+        struct Config
+        {
+            uint64_t updates   = 1000;
+            uint64_t seed      = 1;
+            uint32_t max_image = 256 * 1024;
+            /* Probability of losing a frame in either direction. */
+            double drop = 0.0005;
+            /* Probability of corrupting a write payload. */
+            double corrupt = 0.0005;
+            /* Sessions in a row that execute no new data before the update counts as failed. */
+            uint32_t max_stalls = 20;
+        };
+
+        explicit Soak(const Config & config)
+            : _config(config)
+            , _random(config.seed)
+        {}
+
+        auto run(Results & results) -> void
+        {
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < _config.updates; i++)
+            {
+                update(results);
+            }
+            results.seconds  = std::chrono::duration<double>(Clock::now() - start).count();
+            results.peak_rss = peakRss();
+        }
+
+      private:
+        auto chance(double probability) -> bool
+        {
+            return std::bernoulli_distribution(probability)(_random);
+        }
+
+        template <typename T> auto pick(std::initializer_list<T> values) -> T
+        {
+            std::uniform_int_distribution<size_t> index(0, values.size() - 1);
+            return *(values.begin() + index(_random));
+        }
+
+        auto image(size_t size) -> data_t
+        {
+            data_t data(size);
+            for (auto & byte : data)
+            {
+                byte = static_cast<uint8_t>(_random());
+            }
+            return data;
+        }
+
+        auto update(Results & results) -> void
+        {
+            SimBootloader::Config bootloader;
+            bootloader.mtu = pick<uint16_t>({65, 131, 247, 512, 1024});
+
+            const auto initSize = std::uniform_int_distribution<size_t>(32, bootloader.command_max_size)(_random);
+            const auto init     = image(initSize);
+            const auto firmware = image(std::uniform_int_distribution<size_t>(1, _config.max_image)(_random));
+
+            Session::Config config;
+            config.prn = pick<uint32_t>({0, 1, 4, 16, 64});
+
+            SimBootloader device(bootloader);
+            results.updates++;
+
+            uint32_t stalls = 0;
+            for (uint32_t attempt = 0; stalls < _config.max_stalls; attempt++)
+            {
+                if (attempt > 0)
+                {
+                    results.resumes++;
+                }
+
+                const auto executed = device.executedSize();
+                Session session(init, firmware, config);
+                if (transfer(session, device, results))
+                {
+                    if (device.firmware() != firmware || device.executedSize() != firmware.size())
+                    {
+                        results.failures++;
+                    }
+                    results.bytes += firmware.size();
+                    return;
+                }
+                stalls = (device.executedSize() > executed) ? 0 : stalls + 1;
+            }
+            results.failures++;
+        }
+
+        // Drive one session, lost frames are retried through Session::timeout. False if the session failed, e.g.
+        // after its retries ran out
+        auto transfer(Session & session, SimBootloader & device, Results & results) -> bool
+        {
+            DfuRequest request;
+            DfuResponse response;
+            std::vector<RequestTimers::Expiry> expired;
+
+            // Simulated time, advanced by a millisecond per request and to the expiry on a timeout
+            RequestTimers::Clock::time_point now;
+            RequestTimers timers(TimeoutPolicy{}, std::chrono::milliseconds(1), now);
+
+            while (!session.done())
+            {
+                const auto start = Clock::now();
+                if (session.next(request) != NRFDL_ERR_NONE || _codec.encode(request, _packet) != NRFDL_ERR_NONE)
+                {
+                    return false;
+                }
+
+                if (request.opcode == DfuOpcode::NRF_DFU_OP_OBJECT_WRITE && _packet.size() > 3 &&
+                    chance(_config.corrupt))
+                {
+                    _packet[1] ^= 0x5a;
+                    results.corrupts++;
+                }
+
+                now += std::chrono::milliseconds(1);
+                if (session.awaitingResponse())
+                {
+                    timers.start(0, session.awaiting(), now);
+                }
+
+                _reply.clear();
+                if (chance(_config.drop))
+                {
+                    results.drops++;
+                }
+                else if (device.process(_packet, _reply) != NRFDL_ERR_NONE)
+                {
+                    return false;
+                }
+
+                if (!_reply.empty() && chance(_config.drop))
+                {
+                    results.drops++;
+                    _reply.clear();
+                }
+
+                if (!_reply.empty())
+                {
+                    timers.stop(0);
+                    if (_codec.decode(_reply, response) != NRFDL_ERR_NONE || session.handle(response) != NRFDL_ERR_NONE)
+                    {
+                        return false;
+                    }
+                }
+                else if (session.awaitingResponse())
+                {
+                    for (expired.clear(); expired.empty();)
+                    {
+                        now = *timers.nextExpiry();
+                        timers.expire(now, expired);
+                    }
+                    results.timeouts++;
+                    if (session.timeout() != NRFDL_ERR_NONE)
+                    {
+                        return false;
+                    }
+                }
+
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                results.latency[request.opcode].add(static_cast<uint64_t>(ns));
+            }
+            return true;
+        }
+
+        Config _config;
+        std::mt19937_64 _random;
+        Codec _codec;
+        data_t _packet;
+        data_t _reply;
+    };
+
+    auto readBaseline(const std::string & path, std::map<std::string, double> & baseline) -> bool
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::string key;
+        double value;
+        while (file >> key >> value)
+        {
+            baseline[key] = value;
+        }
+        return true;
+    }
+
+    auto measurements(const Results & results) -> std::map<std::string, double>
+    {
+        std::map<std::string, double> values;
+        values["throughput"] = results.throughput();
+        values["peak_rss"]   = static_cast<double>(results.peak_rss);
+        for (const auto & [opcode, histogram] : results.latency)
+        {
+            values["p99." + opcodeName(opcode)] = static_cast<double>(histogram.percentile(0.99));
+        }
+        return values;
+    }
+
+    auto usage() -> int
+    {
+        fmt::print(stderr,
+                   "usage: sdfu_soak [--updates <n>] [--seed <n>] [--max-image <bytes>] [--drop <p>] [--corrupt <p>]\n"
+                   "                 [--baseline <file>] [--tolerance <fraction>] [--write-baseline <file>]\n");
+        return EXIT_FAILURE;
+    }
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    spdlog::set_level(spdlog::level::off);
+
+    std::map<std::string, std::string> options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string key = argv[i];
+        if (key.rfind("--", 0) != 0)
+        {
+            return usage();
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+
+    if (argc % 2 == 0)
+    {
+        return usage();
+    }
+
+    const auto number = [&options](const std::string & key, double fallback) {
+        const auto it = options.find(key);
+        return (it == options.end()) ? fallback : std::strtod(it->second.c_str(), nullptr);
+    };
+
+    Soak::Config config;
+    config.updates   = static_cast<uint64_t>(number("updates", static_cast<double>(config.updates)));
+    config.seed      = static_cast<uint64_t>(number("seed", static_cast<double>(config.seed)));
+    config.max_image = static_cast<uint32_t>(number("max-image", config.max_image));
+    config.drop      = number("drop", config.drop);
+    config.corrupt   = number("corrupt", config.corrupt);
+
+    Results results;
+    Soak(config).run(results);
+
+    fmt::print("{} updates in {:.2f} s, {:.0f} B/s, {} failed\n",
+               results.updates,
+               results.seconds,
+               results.throughput(),
+               results.failures);
+    fmt::print("{} frames dropped, {} payloads corrupted, {} timeouts, {} resumes, peak RSS {} kB\n",
+               results.drops,
+               results.corrupts,
+               results.timeouts,
+               results.resumes,
+               results.peak_rss);
+    fmt::print("{:>8} {:>10} {:>10} {:>10} {:>10}\n", "opcode", "requests", "p50 us", "p99 us", "p999 us");
+    for (const auto & [opcode, histogram] : results.latency)
+    {
+        fmt::print("{:>8} {:>10} {:>10.1f} {:>10.1f} {:>10.1f}\n",
+                   opcodeName(opcode),
+                   histogram.total(),
+                   static_cast<double>(histogram.percentile(0.5)) / 1e3,
+                   static_cast<double>(histogram.percentile(0.99)) / 1e3,
+                   static_cast<double>(histogram.percentile(0.999)) / 1e3);
+    }
+
+    auto status = (results.failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    const auto current = measurements(results);
+
+    if (options.count("baseline"))
+    {
+        std::map<std::string, double> baseline;
+        if (!readBaseline(options["baseline"], baseline))
+        {
+            fmt::print(stderr, "Cannot read {}\n", options["baseline"]);
+            return EXIT_FAILURE;
+        }
+
+        const auto tolerance = number("tolerance", 0.2);
+        for (const auto & [key, expected] : baseline)
+        {
+            const auto it = current.find(key);
+            if (it == current.end())
+            {
+                continue;
+            }
+
+            // Throughput has to stay up, everything else down
+            const auto regressed = (key == "throughput") ? it->second < expected * (1 - tolerance)
+                                                         : it->second > expected * (1 + tolerance);
+            if (regressed)
+            {
+                fmt::print("Regression in {}: {:.0f}, baseline {:.0f}\n", key, it->second, expected);
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (options.count("write-baseline"))
+    {
+        std::ofstream file(options["write-baseline"]);
+        for (const auto & [key, value] : current)
+        {
+            file << key << ' ' << value << '\n';
+        }
+        if (!file)
+        {
+            fmt::print(stderr, "Cannot write {}\n", options["write-baseline"]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,253 @@
+#include "sdfu_timer.h"
+
+#include <algorithm>
+
+namespace NRFDL::SDFU
+{
+    TimerWheel::TimerWheel(std::chrono::microseconds tick, Clock::time_point start)
+        : _tick(std::max(tick, std::chrono::microseconds(1)))
+        , _start(start)
+        , _now(0)
+        , _free(none)
+        , _armed(0)
+        , _occupied{}
+    {
+        _heads.fill(none);
+    }
+
+    auto TimerWheel::arm(Clock::time_point deadline, uint64_t cookie) -> Handle
+    {
+        // A deadline between two ticks expires at the later one
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(deadline - _start).count();
+        const auto ticks   = elapsed > 0 ? (static_cast<uint64_t>(elapsed) + _tick.count() - 1) / _tick.count() : 0;
+        constexpr uint64_t range = uint64_t{1} << (levels * slotBits);
+
+        uint32_t index = _free;
+        if (index == none)
+        {
+            index = static_cast<uint32_t>(_timers.size());
+            _timers.push_back(Timer{0, 0, none, none, 0, none});
+        }
+        else
+        {
+            _free = _timers[index].next;
+        }
+
+        auto & timer      = _timers[index];
+        timer.expires     = std::clamp(ticks, _now + 1, _now + range - 1);
+        timer.cookie      = cookie;
+        timer.generation  = (timer.generation + 1) ? timer.generation + 1 : 1;
+        link(index);
+        _armed++;
+
+        return (static_cast<Handle>(timer.generation) << 32) | index;
+    }
+
+    auto TimerWheel::cancel(Handle handle) -> bool
+    {
+        const auto index = static_cast<uint32_t>(handle);
+        if (index >= _timers.size() || _timers[index].generation != static_cast<uint32_t>(handle >> 32) ||
+            _timers[index].slot == none)
+        {
+            return false;
+        }
+
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    auto TimerWheel::advance(Clock::time_point now, std::vector<uint64_t> & expired) -> void
+    {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - _start).count();
+        const auto target  = elapsed > 0 ? static_cast<uint64_t>(elapsed) / _tick.count() : 0;
+
+        while (_now < target)
+        {
+            if (_armed == 0)
+            {
+                // Nothing to cascade or expire, jump straight to the target
+                _now = target;
+                break;
+            }
+
+            _now++;
+            const auto index = static_cast<uint32_t>(_now & (slots - 1));
+            if (index == 0)
+            {
+                cascade(1);
+            }
+
+            auto & head = _heads[index];
+            while (head != none)
+            {
+                const auto timer = head;
+                expired.push_back(_timers[timer].cookie);
+                unlink(timer);
+                release(timer);
+            }
+        }
+    }
+
+    auto TimerWheel::nextExpiry() const -> std::optional<Clock::time_point>
+    {
+        if (_armed == 0)
+        {
+            return std::nullopt;
+        }
+
+        // Timers of a higher level expire no earlier than their slot comes around
+        auto earliest = UINT64_MAX;
+        for (uint32_t level = 0; level < levels; level++)
+        {
+            const auto shift   = level * slotBits;
+            const auto current = static_cast<uint32_t>((_now >> shift) & (slots - 1));
+            for (uint32_t distance = 1; distance <= slots; distance++)
+            {
+                const auto slot = (current + distance) & (slots - 1);
+                if (_occupied[level][slot / 64] & (uint64_t{1} << (slot % 64)))
+                {
+                    const auto tick = level ? ((_now >> shift) + distance) << shift : _now + distance;
+                    earliest        = std::min(earliest, tick);
+                    break;
+                }
+            }
+        }
+        return _start + _tick * earliest;
+    }
+
+    auto TimerWheel::armed() const -> size_t
+    {
+        return _armed;
+    }
+
+    auto TimerWheel::link(uint32_t index) -> void
+    {
+        auto & timer       = _timers[index];
+        const auto delta   = timer.expires - _now;
+        uint32_t level     = 0;
+        while (level + 1 < levels && delta >= (uint64_t{1} << ((level + 1) * slotBits)))
+        {
+            level++;
+        }
+
+        const auto slot = static_cast<uint32_t>((timer.expires >> (level * slotBits)) & (slots - 1));
+        auto & head     = _heads[level * slots + slot];
+
+        timer.prev = none;
+        timer.next = head;
+        timer.slot = level * slots + slot;
+        if (head != none)
+        {
+            _timers[head].prev = index;
+        }
+        head = index;
+        _occupied[level][slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+
+    auto TimerWheel::unlink(uint32_t index) -> void
+    {
+        auto & timer = _timers[index];
+        if (timer.prev == none)
+        {
+            _heads[timer.slot] = timer.next;
+            if (timer.next == none)
+            {
+                const auto slot = timer.slot % slots;
+                _occupied[timer.slot / slots][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+            }
+        }
+        else
+        {
+            _timers[timer.prev].next = timer.next;
+        }
+
+        if (timer.next != none)
+        {
+            _timers[timer.next].prev = timer.prev;
+        }
+        timer.slot = none;
+    }
+
+    auto TimerWheel::release(uint32_t index) -> void
+    {
+        _timers[index].next = _free;
+        _free               = index;
+        _armed--;
+    }
+
+    auto TimerWheel::cascade(uint32_t level) -> void
+    {
+        const auto index = static_cast<uint32_t>((_now >> (level * slotBits)) & (slots - 1));
+        if (index == 0 && level + 1 < levels)
+        {
+            cascade(level + 1);
+        }
+
+        // Every timer of the slot expires within the span of the level below now
+        auto head = _heads[level * slots + index];
+        while (head != none)
+        {
+            const auto timer = head;
+            head             = _timers[timer].next;
+            unlink(timer);
+            link(timer);
+        }
+    }
+
+    auto TimeoutPolicy::timeout(DfuOpcode opcode) const -> std::chrono::milliseconds
+    {
+        const auto entry = timeouts.find(opcode);
+        return (entry != timeouts.end()) ? entry->second : fallback;
+    }
+
+    RequestTimers::RequestTimers(const TimeoutPolicy & policy,
+                                 std::chrono::microseconds tick,
+                                 Clock::time_point start)
+        : _policy(policy)
+        , _wheel(tick, start)
+    {}
+
+    auto RequestTimers::start(uint32_t session, DfuOpcode opcode, Clock::time_point now) -> void
+    {
+        stop(session);
+        _pending[session] = {_wheel.arm(now + _policy.timeout(opcode), session), opcode};
+    }
+
+    auto RequestTimers::stop(uint32_t session) -> void
+    {
+        const auto pending = _pending.find(session);
+        if (pending != _pending.end())
+        {
+            _wheel.cancel(pending->second.handle);
+            _pending.erase(pending);
+        }
+    }
+
+    auto RequestTimers::expire(Clock::time_point now, std::vector<Expiry> & expired) -> void
+    {
+        _cookies.clear();
+        _wheel.advance(now, _cookies);
+
+        for (const auto cookie : _cookies)
+        {
+            const auto session = static_cast<uint32_t>(cookie);
+            const auto pending = _pending.find(session);
+            if (pending != _pending.end())
+            {
+                expired.push_back({session, pending->second.opcode});
+                _pending.erase(pending);
+            }
+        }
+    }
+
+    auto RequestTimers::nextExpiry() const -> std::optional<Clock::time_point>
+    {
+        return _wheel.nextExpiry();
+    }
+
+    auto RequestTimers::pending() const -> size_t
+    {
+        return _pending.size();
+    }
+} // namespace NRFDL::SDFU
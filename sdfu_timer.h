@@ -0,0 +1,152 @@
+#pragma once
+
+#include "sdfu_types.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace NRFDL::SDFU
+{
+    /**
+     * @brief Hierarchical timing wheel.
+     *
+     * Four levels of 256 slots, the first one tick wide, each further level 256 times wider than the one below,
+     * cover 2^32 ticks. Timers live in a slab and are linked into their slot, so arming and cancelling take constant
+     * time. Advancing expires one level 0 slot per tick and moves the timers of a higher level slot down when the
+     * level below wraps around. Not thread safe, meant to be owned by the I/O loop.
+     */
+    class TimerWheel
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+        /* Identifies an armed timer, 0 is never returned. */
+        using Handle = uint64_t;
+
+        explicit TimerWheel(std::chrono::microseconds tick = std::chrono::milliseconds(1),
+                            Clock::time_point start             = Clock::now());
+
+        /**
+         * @brief Arm a timer that expires with @p cookie at the first tick at or after @p deadline.
+         *
+         * Deadlines in the past expire at the next tick, deadlines beyond the range of the wheel at its end.
+         */
+        auto arm(Clock::time_point deadline, uint64_t cookie) -> Handle;
+
+        /**
+         * @return false if the timer already expired or was cancelled.
+         */
+        auto cancel(Handle handle) -> bool;
+
+        /**
+         * @brief Advance to @p now and append the cookies of all expired timers in expiry order.
+         */
+        auto advance(Clock::time_point now, std::vector<uint64_t> & expired) -> void;
+
+        /**
+         * @brief Lower bound of the next expiry, to bound the wait of the I/O loop. Empty if nothing is armed.
+         */
+        auto nextExpiry() const -> std::optional<Clock::time_point>;
+
+        auto armed() const -> size_t;
+
+      private:
+        static constexpr uint32_t levels   = 4;
+        static constexpr uint32_t slotBits = 8;
+        static constexpr uint32_t slots    = 1u << slotBits;
+        static constexpr uint32_t none     = UINT32_MAX;
+
+        struct Timer
+        {
+            uint64_t expires;
+            uint64_t cookie;
+            uint32_t prev;
+            uint32_t next;
+            uint32_t generation;
+            /* Level and slot the timer is linked into, none while free. */
+            uint32_t slot;
+        };
+
+        auto ticksAt(Clock::time_point time) const -> uint64_t;
+        auto link(uint32_t index) -> void;
+        auto unlink(uint32_t index) -> void;
+        auto release(uint32_t index) -> void;
+        auto cascade(uint32_t level) -> void;
+
+        std::chrono::microseconds _tick;
+        Clock::time_point _start;
+        uint64_t _now;
+        std::vector<Timer> _timers;
+        uint32_t _free;
+        size_t _armed;
+        std::array<uint32_t, levels * slots> _heads;
+        /* Non-empty slots of each level. */
+        std::array<std::array<uint64_t, slots / 64>, levels> _occupied;
+    };
+
+    /**
+     * @brief Response timeouts by request opcode.
+     */
+    struct TimeoutPolicy
+    {
+        /* Timeout of opcodes without an entry. */
+        std::chrono::milliseconds fallback{500};
+        std::map<DfuOpcode, std::chrono::milliseconds> timeouts{
+            /* The bootloader erases the flash of the object before it answers. */
+            {DfuOpcode::NRF_DFU_OP_OBJECT_CREATE, std::chrono::milliseconds(5000)},
+            /* Executing the last data object validates and may activate the whole image. */
+            {DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE, std::chrono::milliseconds(10000)},
+            /* A receipt follows a whole PRN window of writes. */
+            {DfuOpcode::NRF_DFU_OP_OBJECT_WRITE, std::chrono::milliseconds(1000)},
+        };
+
+        auto timeout(DfuOpcode opcode) const -> std::chrono::milliseconds;
+    };
+
+    /**
+     * @brief Timeouts of the responses sessions of an I/O loop wait for.
+     *
+     * Start the timeout whenever a session awaits a response after @ref Session::next and stop it when the response
+     * arrives. Expired sessions are reported in batches by @ref expire; pass each to @ref Session::timeout.
+     */
+    class RequestTimers
+    {
+      public:
+        using Clock = TimerWheel::Clock;
+
+        struct Expiry
+        {
+            uint32_t session;
+            DfuOpcode opcode;
+        };
+
+        explicit RequestTimers(const TimeoutPolicy & policy = TimeoutPolicy{},
+                               std::chrono::microseconds tick = std::chrono::milliseconds(1),
+                               Clock::time_point start        = Clock::now());
+
+        /**
+         * @brief Arm the timeout of the response @p session awaits to @p opcode, replacing an armed one.
+         */
+        auto start(uint32_t session, DfuOpcode opcode, Clock::time_point now = Clock::now()) -> void;
+        auto stop(uint32_t session) -> void;
+        auto expire(Clock::time_point now, std::vector<Expiry> & expired) -> void;
+        auto nextExpiry() const -> std::optional<Clock::time_point>;
+        auto pending() const -> size_t;
+
+      private:
+        struct Pending
+        {
+            TimerWheel::Handle handle;
+            DfuOpcode opcode;
+        };
+
+        TimeoutPolicy _policy;
+        TimerWheel _wheel;
+        std::unordered_map<uint32_t, Pending> _pending;
+        std::vector<uint64_t> _cookies;
+    };
+} // namespace NRFDL::SDFU
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory_resource>
 #include <optional>
 #include <variant>
 #include <vector>
@@ -206,7 +207,11 @@ namespace NRFDL::SDFU
     struct DfuRequestWrite
     {
         DfuRequestWrite(){};
-        std::vector<uint8_t> data;
+        explicit DfuRequestWrite(std::pmr::memory_resource * memory)
+            : data(memory)
+        {}
+        /* Copies of a request allocate from the default resource, moves keep the resource. */
+        std::pmr::vector<uint8_t> data;
         uint16_t len;
     };
 
@@ -72,6 +72,42 @@ namespace
 
                 REQUIRE(data == expected);
             }
+
+            SECTION("Fixed frames")
+            {
+                DfuRequest req;
+                std::vector<uint8_t> data;
+
+                req.opcode = DfuOpcode::NRF_DFU_OP_CRC_GET;
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+                REQUIRE(data == std::vector<uint8_t>{0x03});
+
+                req.opcode = DfuOpcode::NRF_DFU_OP_OBJECT_SELECT;
+                req.request = DfuRequestSelect{2};
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+                REQUIRE(data == std::vector<uint8_t>{0x06, 0x02, 0x00, 0x00, 0x00});
+
+                req.opcode = DfuOpcode::NRF_DFU_OP_OBJECT_CREATE;
+                req.request = DfuRequestCreate{1, 0x1000};
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+                REQUIRE(data == std::vector<uint8_t>{0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00});
+
+                req.opcode = DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET;
+                req.request = DfuRequestPrn{4};
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+                REQUIRE(data == std::vector<uint8_t>{0x02, 0x04, 0x00, 0x00, 0x00});
+
+                req.opcode = DfuOpcode::NRF_DFU_OP_MTU_GET;
+                req.request = DfuRequestMtu{0x0203};
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+                REQUIRE(data == std::vector<uint8_t>{0x07, 0x03, 0x02});
+
+                // Without the argument the bitsery encoder writes the header only
+                req.opcode = DfuOpcode::NRF_DFU_OP_PING;
+                req.request.reset();
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+                REQUIRE(data == std::vector<uint8_t>{0x09});
+            }
         }
 
         SECTION("Decode responses")
@@ -134,6 +170,61 @@ namespace
                 REQUIRE(resp.result == DfuResult::NRF_DFU_RES_CODE_SUCCESS);
             }
         }
+
+        SECTION("Round trip")
+        {
+            SECTION("Request")
+            {
+                DfuRequest req;
+                std::vector<uint8_t> data;
+
+                req.opcode = DfuOpcode::NRF_DFU_OP_OBJECT_CREATE;
+                DfuRequestCreate create;
+                create.object_type = 2;
+                create.object_size = 4096;
+                req.request        = create;
+                REQUIRE(codec.encode(req, data) == NRFDL_ERR_NONE);
+
+                DfuRequest decoded;
+                REQUIRE(codec.decode(data, decoded) == NRFDL_ERR_NONE);
+                REQUIRE(decoded.opcode == DfuOpcode::NRF_DFU_OP_OBJECT_CREATE);
+                REQUIRE(std::get<DfuRequestCreate>(*(decoded.request)).object_size == 4096);
+            }
+
+            SECTION("ObjectWrite request")
+            {
+                std::vector<uint8_t> input{
+                    static_cast<std::underlying_type<DfuOpcode>::type>(DfuOpcode::NRF_DFU_OP_OBJECT_WRITE),
+                    0x0a,
+                    0x0b,
+                    0x02, // length
+                    0x00};
+
+                DfuRequest decoded;
+                REQUIRE(codec.decode(input, decoded) == NRFDL_ERR_NONE);
+                const auto write = std::get<DfuRequestWrite>(*(decoded.request));
+                REQUIRE(write.data == std::pmr::vector<uint8_t>{0x0a, 0x0b});
+
+                input.back() = 0x01;
+                REQUIRE(codec.decode(input, decoded) == NRFDL_ERR_PROTOCOL);
+            }
+
+            SECTION("MTU response")
+            {
+                DfuResponse resp;
+                std::vector<uint8_t> data;
+
+                resp.opcode   = DfuOpcode::NRF_DFU_OP_MTU_GET;
+                resp.result   = DfuResult::NRF_DFU_RES_CODE_SUCCESS;
+                resp.response = DfuResponseMtu{131};
+                REQUIRE(codec.encode(resp, data) == NRFDL_ERR_NONE);
+                REQUIRE(data.size() == 4);
+
+                DfuResponse decoded;
+                REQUIRE(codec.decode(data, decoded) == NRFDL_ERR_NONE);
+                REQUIRE(std::get<DfuResponseMtu>(*(decoded.response)).size == 131);
+            }
+        }
     }
 
 }; // namespace
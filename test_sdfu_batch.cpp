@@ -0,0 +1,316 @@
+#include "catch.hpp"
+
+#include "sdfu_batch.h"
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_codec.h"
+#include "sdfu_object_store.h"
+#include "sdfu_session.h"
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto flatten(FrameBatch & batch) -> data_t
+    {
+        data_t bytes;
+        for (const auto & vector : batch.iovecs())
+        {
+            const auto base = static_cast<const uint8_t *>(vector.iov_base);
+            bytes.insert(bytes.end(), base, base + vector.iov_len);
+        }
+        return bytes;
+    }
+
+    // Send every batch as its frames, as a gather write on a framed transport would
+    auto run(Session & session, SimBootloader & device, size_t & batches) -> nrfdl_errorcode_t
+    {
+        Codec codec;
+        FrameBatch batch;
+        DfuResponse response;
+        data_t reply;
+
+        while (!session.done())
+        {
+            batch.clear();
+            const auto error = session.nextBatch(batch);
+            if (error != NRFDL_ERR_NONE)
+            {
+                return error;
+            }
+            batches++;
+
+            const auto bytes = flatten(batch);
+            REQUIRE(bytes.size() == batch.size());
+
+            size_t offset = 0;
+            for (const auto size : batch.frameSizes())
+            {
+                const data_t frame(bytes.begin() + offset, bytes.begin() + offset + size);
+                offset += size;
+
+                REQUIRE(device.process(frame, reply) == NRFDL_ERR_NONE);
+                if (!reply.empty())
+                {
+                    REQUIRE(codec.decode(reply, response) == NRFDL_ERR_NONE);
+                    REQUIRE(session.handle(response) == NRFDL_ERR_NONE);
+                }
+            }
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    TEST_CASE("Test frame batch", "[batch]")
+    {
+        Codec codec;
+        FrameBatch batch;
+
+        SECTION("Same bytes as the codec")
+        {
+            const data_t image{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+            DfuRequest crc;
+            crc.opcode = DfuOpcode::NRF_DFU_OP_CRC_GET;
+
+            DfuRequest create;
+            create.opcode  = DfuOpcode::NRF_DFU_OP_OBJECT_CREATE;
+            create.request = DfuRequestCreate{2, 10};
+
+            DfuRequestWrite details;
+            details.data.assign(image.begin(), image.end());
+            details.len  = 10;
+            DfuRequest write;
+            write.opcode  = DfuOpcode::NRF_DFU_OP_OBJECT_WRITE;
+            write.request = details;
+
+            REQUIRE(batch.add(create) == NRFDL_ERR_NONE);
+            REQUIRE(batch.addWrite(image.data(), 4) == NRFDL_ERR_NONE);
+            REQUIRE(batch.addWrite(image.data() + 4, 6) == NRFDL_ERR_NONE);
+            REQUIRE(batch.add(write) == NRFDL_ERR_NONE);
+            REQUIRE(batch.add(crc) == NRFDL_ERR_NONE);
+            REQUIRE(batch.frames() == 5);
+
+            // The two zero copy writes split the image in the frame layout of the codec
+            data_t expected;
+            data_t packet;
+            REQUIRE(codec.encode(create, packet) == NRFDL_ERR_NONE);
+            expected.insert(expected.end(), packet.begin(), packet.end());
+            expected.insert(expected.end(), {0x08, 0, 1, 2, 3, 4, 0});
+            expected.insert(expected.end(), {0x08, 4, 5, 6, 7, 8, 9, 6, 0});
+            REQUIRE(codec.encode(write, packet) == NRFDL_ERR_NONE);
+            expected.insert(expected.end(), packet.begin(), packet.end());
+            REQUIRE(codec.encode(crc, packet) == NRFDL_ERR_NONE);
+            expected.insert(expected.end(), packet.begin(), packet.end());
+            REQUIRE(flatten(batch) == expected);
+
+            // Create header, payload, trailer and header, payload, then the rest from the buffer
+            const auto & vectors = batch.iovecs();
+            REQUIRE(vectors.size() == 5);
+            REQUIRE(vectors[1].iov_base == image.data());
+            REQUIRE(vectors[3].iov_base == image.data() + 4);
+
+            batch.clear();
+            REQUIRE(batch.empty());
+            REQUIRE(batch.size() == 0);
+            REQUIRE(batch.iovecs().empty());
+        }
+
+        SECTION("Pre-encoded requests")
+        {
+            const data_t frames{0x08, 0xaa, 0x01, 0x00, 0x08, 0xbb, 0x01, 0x00};
+
+            DfuRequest crc;
+            crc.opcode = DfuOpcode::NRF_DFU_OP_CRC_GET;
+
+            REQUIRE(batch.addEncoded(frames.data(), 4) == NRFDL_ERR_NONE);
+            REQUIRE(batch.addEncoded(frames.data() + 4, 4) == NRFDL_ERR_NONE);
+            REQUIRE(batch.add(crc) == NRFDL_ERR_NONE);
+            REQUIRE(batch.addEncoded(nullptr, 4) == NRFDL_ERR_ARGUMENT);
+
+            REQUIRE(batch.frames() == 3);
+            REQUIRE(batch.frameSizes() == std::vector<size_t>{4, 4, 1});
+            REQUIRE(flatten(batch) == data_t{0x08, 0xaa, 0x01, 0x00, 0x08, 0xbb, 0x01, 0x00, 0x03});
+
+            // Adjacent frames go out as one entry
+            const auto & vectors = batch.iovecs();
+            REQUIRE(vectors.size() == 2);
+            REQUIRE(vectors[0].iov_base == frames.data());
+            REQUIRE(vectors[0].iov_len == 8);
+        }
+
+        SECTION("Session")
+        {
+            data_t init(140);
+            data_t firmware(10000);
+            for (size_t i = 0; i < firmware.size(); i++)
+            {
+                firmware[i] = static_cast<uint8_t>(i * 7);
+            }
+
+            SimBootloader::Config bootloader;
+            bootloader.mtu = 131;
+
+            SECTION("Without receipts")
+            {
+                SimBootloader device(bootloader);
+                Session session(init, firmware);
+                size_t batches = 0;
+                REQUIRE(run(session, device, batches) == NRFDL_ERR_NONE);
+                REQUIRE(device.firmware() == firmware);
+
+                // PRN and MTU, select, create, writes with CRC and execute of the command object, then one select
+                // and create, writes with CRC and execute of each of the three data objects
+                REQUIRE(batches == 2 + 4 + 1 + 3 * 3);
+            }
+
+            SECTION("With receipts")
+            {
+                Session::Config config;
+                config.prn = 8;
+
+                SimBootloader device(bootloader);
+                Session session(init, firmware, config);
+                size_t batches = 0;
+                REQUIRE(run(session, device, batches) == NRFDL_ERR_NONE);
+                REQUIRE(device.firmware() == firmware);
+                REQUIRE(session.nextBatch(batch) == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+            }
+
+            SECTION("From an object store")
+            {
+                ObjectStore::Config objects;
+                objects.chunk = writePayloadSize(bootloader.mtu);
+                ObjectStore store(objects);
+                auto image = store.add(firmware);
+
+                SimBootloader device(bootloader);
+                Session session(init, image);
+                size_t batches = 0;
+                REQUIRE(run(session, device, batches) == NRFDL_ERR_NONE);
+                REQUIRE(device.firmware() == firmware);
+                REQUIRE(batches == 2 + 4 + 1 + 3 * 3);
+            }
+
+            SECTION("Object writes in one iovec")
+            {
+                ObjectStore::Config objects;
+                objects.chunk = writePayloadSize(bootloader.mtu);
+                ObjectStore store(objects);
+                auto image = store.add(firmware);
+
+                SimBootloader device(bootloader);
+                Session session(init, image);
+                DfuResponse response;
+                data_t reply;
+                Codec codec;
+
+                // Drive the session up to the writes of the first data object
+                while (session.state() != Session::State::DataWrite)
+                {
+                    batch.clear();
+                    REQUIRE(session.nextBatch(batch) == NRFDL_ERR_NONE);
+                    const auto bytes = flatten(batch);
+                    size_t offset    = 0;
+                    for (const auto size : batch.frameSizes())
+                    {
+                        REQUIRE(device.process(data_t(bytes.begin() + offset, bytes.begin() + offset + size), reply) ==
+                                NRFDL_ERR_NONE);
+                        offset += size;
+                        if (!reply.empty())
+                        {
+                            REQUIRE(codec.decode(reply, response) == NRFDL_ERR_NONE);
+                            REQUIRE(session.handle(response) == NRFDL_ERR_NONE);
+                        }
+                    }
+                }
+
+                batch.clear();
+                REQUIRE(session.nextBatch(batch) == NRFDL_ERR_NONE);
+                REQUIRE(batch.iovecs().size() == 2);
+                REQUIRE(batch.iovecs()[0].iov_base == image.objects()[0]->frames.data());
+            }
+        }
+
+#if !defined(_WIN32)
+        SECTION("Write to a file descriptor")
+        {
+            const data_t image(4000, 0x5a);
+            for (size_t offset = 0; offset < image.size(); offset += 100)
+            {
+                REQUIRE(batch.addWrite(image.data() + offset, 100) == NRFDL_ERR_NONE);
+            }
+
+            int fds[2];
+            REQUIRE(::pipe(fds) == 0);
+            size_t written = 0;
+            REQUIRE(batch.writeTo(fds[1], written) == NRFDL_ERR_NONE);
+            REQUIRE(written == batch.size());
+            ::close(fds[1]);
+
+            data_t received(batch.size() + 1);
+            size_t total = 0;
+            ssize_t count;
+            while ((count = ::read(fds[0], received.data() + total, received.size() - total)) > 0)
+            {
+                total += static_cast<size_t>(count);
+            }
+            ::close(fds[0]);
+
+            received.resize(total);
+            REQUIRE(received == flatten(batch));
+        }
+
+        SECTION("Resume on a non-blocking file descriptor")
+        {
+            // Larger than the pipe buffer, so the write stops part way
+            const data_t image(200000, 0xa5);
+            for (size_t offset = 0; offset < image.size(); offset += 1000)
+            {
+                REQUIRE(batch.addWrite(image.data() + offset, 1000) == NRFDL_ERR_NONE);
+            }
+
+            int fds[2];
+            REQUIRE(::pipe(fds) == 0);
+            REQUIRE(::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK) == 0);
+
+            data_t received;
+            data_t chunk(4096);
+            size_t written = 0;
+            while (written < batch.size())
+            {
+                const auto before = written;
+                REQUIRE(batch.writeTo(fds[1], written) == NRFDL_ERR_NONE);
+                if (written == before)
+                {
+                    const auto count = ::read(fds[0], chunk.data(), chunk.size());
+                    REQUIRE(count > 0);
+                    received.insert(received.end(), chunk.begin(), chunk.begin() + count);
+                }
+            }
+            ::close(fds[1]);
+
+            ssize_t count;
+            while ((count = ::read(fds[0], chunk.data(), chunk.size())) > 0)
+            {
+                received.insert(received.end(), chunk.begin(), chunk.begin() + count);
+            }
+            ::close(fds[0]);
+            REQUIRE(received == flatten(batch));
+
+            // A reader going away closes the batch
+            REQUIRE(::pipe(fds) == 0);
+            ::close(fds[0]);
+            ::signal(SIGPIPE, SIG_IGN);
+            written = 0;
+            REQUIRE(batch.writeTo(fds[1], written) == NRFDL_ERR_CLOSED);
+            REQUIRE(written == 0);
+            ::close(fds[1]);
+        }
+#endif
+    }
+}; // namespace
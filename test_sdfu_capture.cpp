@@ -0,0 +1,157 @@
+#include "catch.hpp"
+
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_capture.h"
+#include "sdfu_codec.h"
+#include "sdfu_session.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    // Run a session against a simulated bootloader and capture its frames, one millisecond apart
+    auto capture(CaptureWriter & writer, uint32_t id, size_t firmwareSize, CaptureWriter::Clock::time_point & now)
+        -> void
+    {
+        const data_t init(140, 1);
+        const data_t firmware(firmwareSize, 2);
+
+        SimBootloader::Config config;
+        config.mtu = 131;
+
+        SimBootloader device(config);
+        Session session(init, firmware);
+        Codec codec;
+        DfuRequest request;
+        DfuResponse response;
+        data_t packet;
+        data_t reply;
+
+        while (!session.done())
+        {
+            REQUIRE(session.next(request) == NRFDL_ERR_NONE);
+            REQUIRE(codec.encode(request, packet) == NRFDL_ERR_NONE);
+            REQUIRE(writer.record(id, CaptureDirection::HostToDevice, packet, now) == NRFDL_ERR_NONE);
+            now += std::chrono::milliseconds(1);
+
+            REQUIRE(device.process(packet, reply) == NRFDL_ERR_NONE);
+            if (!reply.empty())
+            {
+                REQUIRE(writer.record(id, CaptureDirection::DeviceToHost, reply, now) == NRFDL_ERR_NONE);
+                REQUIRE(codec.decode(reply, response) == NRFDL_ERR_NONE);
+                REQUIRE(session.handle(response) == NRFDL_ERR_NONE);
+            }
+        }
+    }
+
+    TEST_CASE("Test capture", "[capture]")
+    {
+        const auto path = (std::filesystem::temp_directory_path() / "test_sdfu_capture.cap").string();
+
+        auto now = CaptureWriter::Clock::now();
+        {
+            CaptureWriter writer;
+            REQUIRE(writer.open(path, now) == NRFDL_ERR_NONE);
+            capture(writer, 7, 10000, now);
+            capture(writer, 9, 5000, now);
+            REQUIRE(writer.close() == NRFDL_ERR_NONE);
+        }
+
+        SECTION("Analyze")
+        {
+            CaptureAnalyzer::Config config;
+            config.threads = 4;
+
+            CaptureAnalyzer analyzer(config);
+            REQUIRE(analyzer.open(path) == NRFDL_ERR_NONE);
+            REQUIRE(analyzer.sessions() == std::vector<uint32_t>{7, 9});
+
+            std::map<DfuOpcode, OpcodeTable> tables;
+            REQUIRE(analyzer.analyze(tables) == NRFDL_ERR_NONE);
+            REQUIRE(analyzer.decodeErrors() == 0);
+
+            // One command and three data objects, then one command and two data objects
+            const auto & create = tables[DfuOpcode::NRF_DFU_OP_OBJECT_CREATE];
+            REQUIRE(create.rows() == 7);
+            REQUIRE(create.size[1] == 4096);
+            REQUIRE(create.session.back() == 9);
+
+            const auto & crc = tables[DfuOpcode::NRF_DFU_OP_CRC_GET];
+            REQUIRE(crc.rows() == 7);
+            REQUIRE(crc.offset[3] == 10000);
+            REQUIRE(crc.latency[3] == 1000000);
+            REQUIRE(crc.result[3] == DfuResult::NRF_DFU_RES_CODE_SUCCESS);
+
+            // Without receipts no write is answered
+            const auto & write = tables[DfuOpcode::NRF_DFU_OP_OBJECT_WRITE];
+            REQUIRE(write.rows() > 0);
+            REQUIRE(std::all_of(write.latency.begin(), write.latency.end(), [](uint64_t l) { return l == 0; }));
+
+            // The result does not depend on the number of threads
+            CaptureAnalyzer single(CaptureAnalyzer::Config{1});
+            REQUIRE(single.open(path) == NRFDL_ERR_NONE);
+            std::map<DfuOpcode, OpcodeTable> singleTables;
+            REQUIRE(single.analyze(singleTables) == NRFDL_ERR_NONE);
+            REQUIRE(singleTables[DfuOpcode::NRF_DFU_OP_OBJECT_WRITE].size == write.size);
+            REQUIRE(singleTables[DfuOpcode::NRF_DFU_OP_CRC_GET].crc == crc.crc);
+        }
+
+        SECTION("Replay")
+        {
+            CaptureAnalyzer analyzer;
+            REQUIRE(analyzer.open(path) == NRFDL_ERR_NONE);
+
+            SimBootloader::Config config;
+            config.mtu = 131;
+
+            SimBootloader same(config);
+            ReplayResult result;
+            REQUIRE(analyzer.replay(9, same, result) == NRFDL_ERR_NONE);
+            REQUIRE(result.requests > 0);
+            REQUIRE(result.mismatches == 0);
+            REQUIRE(result.first_mismatch == SIZE_MAX);
+
+            // Only the MTU response differs, the captured writes fit the larger MTU as well
+            config.mtu = 247;
+            SimBootloader larger(config);
+            REQUIRE(analyzer.replay(9, larger, result) == NRFDL_ERR_NONE);
+            REQUIRE(result.mismatches == 1);
+            REQUIRE(result.first_mismatch != SIZE_MAX);
+
+            // A bootloader with smaller data objects reports another object size and rejects the captured creates
+            config.mtu           = 131;
+            config.data_max_size = 1024;
+            SimBootloader other(config);
+            REQUIRE(analyzer.replay(9, other, result) == NRFDL_ERR_NONE);
+            REQUIRE(result.mismatches > 1);
+        }
+
+        SECTION("Truncated and invalid files")
+        {
+            {
+                std::ifstream in(path, std::ios::binary);
+                std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                out << contents.substr(0, contents.size() - 1);
+            }
+
+            CaptureAnalyzer analyzer;
+            REQUIRE(analyzer.open(path) == NRFDL_ERR_NONE);
+            REQUIRE(analyzer.records() > 0);
+
+            {
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                out << "not a capture";
+            }
+            REQUIRE(analyzer.open(path) == NRFDL_ERR_ARGUMENT);
+        }
+
+        std::remove(path.c_str());
+    }
+}; // namespace
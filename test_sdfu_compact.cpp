@@ -0,0 +1,120 @@
+#include "catch.hpp"
+
+#include "sdfu_compact.h"
+
+#include <type_traits>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto roundTrip(const DfuResponse & response) -> DfuResponse
+    {
+        CompactResponse compact;
+        REQUIRE(CompactResponse::pack(response, compact) == NRFDL_ERR_NONE);
+        REQUIRE(compact.opcode() == response.opcode);
+        REQUIRE(compact.result() == response.result);
+
+        DfuResponse unpacked;
+        compact.unpack(unpacked);
+        REQUIRE(unpacked.opcode == response.opcode);
+        REQUIRE(unpacked.result == response.result);
+        return unpacked;
+    }
+
+    auto response(DfuOpcode opcode, std::optional<DfuResponseType> details) -> DfuResponse
+    {
+        DfuResponse response;
+        response.opcode   = opcode;
+        response.result   = DfuResult::NRF_DFU_RES_CODE_SUCCESS;
+        response.response = details;
+        return response;
+    }
+
+    TEST_CASE("Test compact responses", "[compact]")
+    {
+        REQUIRE(sizeof(CompactResponse) == 16);
+        REQUIRE(std::is_trivially_copyable_v<CompactResponse>);
+
+        SECTION("Object responses")
+        {
+            const auto select =
+                roundTrip(response(DfuOpcode::NRF_DFU_OP_OBJECT_SELECT, DfuResponseSelect{0x100, 0xdeadbeef, 4096}));
+            const auto & selected = std::get<DfuResponseSelect>(*select.response);
+            REQUIRE(selected.offset == 0x100);
+            REQUIRE(selected.crc == 0xdeadbeef);
+            REQUIRE(selected.max_size == 4096);
+
+            const auto create = roundTrip(response(DfuOpcode::NRF_DFU_OP_OBJECT_CREATE, DfuResponseCreate{1, 2}));
+            REQUIRE(std::get<DfuResponseCreate>(*create.response).crc == 2);
+
+            const auto write = roundTrip(response(DfuOpcode::NRF_DFU_OP_OBJECT_WRITE, DfuResponseWrite{3, 4}));
+            REQUIRE(std::get<DfuResponseWrite>(*write.response).offset == 3);
+
+            CompactResponse compact;
+            REQUIRE(CompactResponse::pack(response(DfuOpcode::NRF_DFU_OP_CRC_GET, DfuResponseCrc{5, 6}), compact) ==
+                    NRFDL_ERR_NONE);
+            REQUIRE(compact.offset() == 5);
+            REQUIRE(compact.crc() == 6);
+        }
+
+        SECTION("Version responses")
+        {
+            const auto protocol = roundTrip(response(DfuOpcode::NRF_DFU_OP_PROTOCOL_VERSION, DfuResponseProtocol{1}));
+            REQUIRE(std::get<DfuResponseProtocol>(*protocol.response).version == 1);
+
+            const auto ping = roundTrip(response(DfuOpcode::NRF_DFU_OP_PING, DfuResponsePing{0xab}));
+            REQUIRE(std::get<DfuResponsePing>(*ping.response).id == 0xab);
+
+            const auto mtu = roundTrip(response(DfuOpcode::NRF_DFU_OP_MTU_GET, DfuResponseMtu{131}));
+            REQUIRE(std::get<DfuResponseMtu>(*mtu.response).size == 131);
+
+            const auto firmware = roundTrip(response(
+                DfuOpcode::NRF_DFU_OP_FIRMWARE_VERSION,
+                DfuResponseFirmware{DfuFirmwareType::NRF_DFU_FIRMWARE_TYPE_BOOTLOADER, 7, 0xf8000, 0x6000}));
+            const auto & image = std::get<DfuResponseFirmware>(*firmware.response);
+            REQUIRE(image.type == DfuFirmwareType::NRF_DFU_FIRMWARE_TYPE_BOOTLOADER);
+            REQUIRE(image.version == 7);
+            REQUIRE(image.addr == 0xf8000);
+            REQUIRE(image.len == 0x6000);
+
+            const DfuResponseHardware details{0x52840, 0x41414430, {0x100000, 0x40000, 4096}};
+            const auto hardware = roundTrip(response(DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION, details));
+            const auto & device = std::get<DfuResponseHardware>(*hardware.response);
+            REQUIRE(device.part == 0x52840);
+            REQUIRE(device.variant == 0x41414430);
+            REQUIRE(device.memory.rom_size == 0x100000);
+            REQUIRE(device.memory.ram_size == 0x40000);
+            REQUIRE(device.memory.rom_page_size == 4096);
+        }
+
+        SECTION("Responses without details")
+        {
+            for (const auto opcode : {DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET,
+                                      DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE,
+                                      DfuOpcode::NRF_DFU_OP_ABORT})
+            {
+                REQUIRE_FALSE(roundTrip(response(opcode, std::nullopt)).response);
+            }
+
+            // Opcodes with details unpack zeroed details, as decoded from the wire
+            auto failed   = response(DfuOpcode::NRF_DFU_OP_OBJECT_CREATE, std::nullopt);
+            failed.result = DfuResult::NRF_DFU_RES_CODE_INSUFFICIENT_RESOURCES;
+            const auto create = roundTrip(failed);
+            REQUIRE(std::get<DfuResponseCreate>(*create.response).offset == 0);
+        }
+
+        SECTION("Unrepresentable hardware")
+        {
+            CompactResponse compact;
+            REQUIRE(CompactResponse::pack(response(DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION,
+                                                   DfuResponseHardware{1, 2, {1000, 0x40000, 4096}}),
+                                          compact) == NRFDL_ERR_ARGUMENT);
+            REQUIRE(CompactResponse::pack(response(DfuOpcode::NRF_DFU_OP_HARDWARE_VERSION,
+                                                   DfuResponseHardware{1, 2, {0x100000, 0x40000, 3000}}),
+                                          compact) == NRFDL_ERR_ARGUMENT);
+            // The target is left untouched
+            REQUIRE(compact.result() == DfuResult::NRF_DFU_RES_CODE_INVALID);
+        }
+    }
+}; // namespace
@@ -0,0 +1,172 @@
+#include "catch.hpp"
+
+#include "sdfu_discovery.h"
+#include "sdfu_scheduler.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    auto attribute(const fs::path & path, const std::string & value) -> void
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << value << "\n";
+    }
+
+    // Fake sysfs entry of a device with one interface per given class triple
+    auto plug(const fs::path & root,
+              const std::string & topology,
+              const std::string & devnum,
+              const std::string & vendor,
+              const std::string & product,
+              const std::vector<std::array<std::string, 3>> & interfaces) -> void
+    {
+        const auto device = root / "bus/usb/devices" / topology;
+        attribute(device / "busnum", "1");
+        attribute(device / "devnum", devnum);
+        attribute(device / "idVendor", vendor);
+        attribute(device / "idProduct", product);
+        attribute(device / "serial", "SN" + topology);
+
+        for (size_t i = 0; i < interfaces.size(); i++)
+        {
+            const auto interface = device / (topology + ":1." + std::to_string(i));
+            attribute(interface / "bInterfaceClass", interfaces[i][0]);
+            attribute(interface / "bInterfaceSubClass", interfaces[i][1]);
+            attribute(interface / "bInterfaceProtocol", interfaces[i][2]);
+        }
+    }
+
+    auto uevent(const std::string & action, const std::string & devpath, const std::string & subsystem) -> std::string
+    {
+        const auto text = action + "@" + devpath + '\0' + "ACTION=" + action + '\0' + "DEVPATH=" + devpath + '\0' +
+                          "SUBSYSTEM=" + subsystem + '\0';
+        return text;
+    }
+
+    TEST_CASE("Test device discovery", "[discovery]")
+    {
+        const auto root = fs::temp_directory_path() / "test_sdfu_discovery";
+        fs::remove_all(root);
+
+        // Open bootloader with a CDC ACM port, a J-Link behind a hub and an application with the DFU trigger
+        plug(root, "1-2", "5", "1915", "521f", {{"02", "02", "01"}, {"0a", "00", "00"}});
+        fs::create_directories(root / "bus/usb/devices/1-2/1-2:1.1/tty/ttyACM0");
+        plug(root, "1-3.1", "7", "1366", "1015", {{"02", "02", "01"}});
+        fs::create_directories(root / "bus/usb/devices/1-3.1/1-3.1:1.0/tty/ttyACM1");
+        plug(root, "1-4", "9", "1915", "c00a", {{"ff", "fe", "01"}});
+        fs::create_directories(root / "bus/usb/devices/usb1");
+        fs::create_directories(root / "bus/usb/devices/1-4:1.0");
+
+        DeviceDiscovery::Config config;
+        config.sysfs   = root.string();
+        config.threads = 4;
+        DeviceDiscovery discovery(config);
+
+        std::vector<DeviceEvent> events;
+        REQUIRE(discovery.scan(events) == NRFDL_ERR_NONE);
+        REQUIRE(events.size() == 3);
+        REQUIRE(std::all_of(events.begin(), events.end(), [](const DeviceEvent & e) {
+            return e.change == DeviceChange::Added;
+        }));
+
+        UsbDevice device;
+        REQUIRE(discovery.device("1-2", device) == NRFDL_ERR_NONE);
+        REQUIRE(device.vendor_id == 0x1915);
+        REQUIRE(device.product_id == 0x521F);
+        REQUIRE(device.serial_number == "SN1-2");
+        REQUIRE(device.traits.usb);
+        REQUIRE(device.traits.nordic_usb);
+        REQUIRE(device.traits.nordic_dfu);
+        REQUIRE(device.traits.serialport);
+        REQUIRE(device.serial_ports == std::vector<std::string>{"/dev/ttyACM0"});
+
+        REQUIRE(discovery.device("1-3.1", device) == NRFDL_ERR_NONE);
+        REQUIRE(device.traits.segger_usb);
+        REQUIRE(device.traits.jlink);
+        REQUIRE_FALSE(device.traits.nordic_usb);
+        REQUIRE(HubScheduler::groupOf(device.topology) == "1-3");
+
+        REQUIRE(discovery.device("1-4", device) == NRFDL_ERR_NONE);
+        REQUIRE(device.traits.nordic_dfu);
+        REQUIRE_FALSE(device.traits.serialport);
+
+        REQUIRE(discovery.device("usb1", device) == NRFDL_ERR_ARGUMENT);
+
+        SECTION("Rescan")
+        {
+            events.clear();
+            REQUIRE(discovery.scan(events) == NRFDL_ERR_NONE);
+            REQUIRE(events.empty());
+
+            // Re-enumerated and unplugged devices
+            attribute(root / "bus/usb/devices/1-2/devnum", "12");
+            fs::remove_all(root / "bus/usb/devices/1-3.1");
+            REQUIRE(discovery.scan(events) == NRFDL_ERR_NONE);
+            REQUIRE(events.size() == 3);
+            REQUIRE(events[0].change == DeviceChange::Removed);
+            REQUIRE(events[0].device.topology == "1-2");
+            REQUIRE(events[1].change == DeviceChange::Removed);
+            REQUIRE(events[1].device.topology == "1-3.1");
+            REQUIRE(events[2].change == DeviceChange::Added);
+            REQUIRE(events[2].device.topology == "1-2");
+            REQUIRE(discovery.devices().size() == 2);
+
+            // A tty binding late shows up without re-enumeration
+            events.clear();
+            fs::create_directories(root / "bus/usb/devices/1-4/1-4:1.0/tty/ttyACM2");
+            REQUIRE(discovery.scan(events) == NRFDL_ERR_NONE);
+            REQUIRE(events.size() == 1);
+            REQUIRE(events[0].change == DeviceChange::Changed);
+            REQUIRE(events[0].device.serial_ports == std::vector<std::string>{"/dev/ttyACM2"});
+            REQUIRE(discovery.device("1-4", device) == NRFDL_ERR_NONE);
+            REQUIRE(device.traits.serialport);
+        }
+
+        SECTION("Uevents")
+        {
+            const std::string usb1 = "/devices/pci0000:00/0000:00:14.0/usb1";
+
+            events.clear();
+            plug(root, "1-5", "14", "1915", "521f", {{"02", "02", "01"}});
+            auto message = uevent("add", usb1 + "/1-5", "usb");
+            discovery.handleUevent(message.data(), message.size(), events);
+            REQUIRE(events.size() == 1);
+            REQUIRE(events[0].change == DeviceChange::Added);
+            REQUIRE_FALSE(events[0].device.traits.serialport);
+
+            // The tty node of the interface shows up after the device
+            events.clear();
+            fs::create_directories(root / "bus/usb/devices/1-5/1-5:1.0/tty/ttyACM2");
+            message = uevent("add", usb1 + "/1-5/1-5:1.0/tty/ttyACM2", "tty");
+            discovery.handleUevent(message.data(), message.size(), events);
+            REQUIRE(events.size() == 1);
+            REQUIRE(events[0].change == DeviceChange::Changed);
+            REQUIRE(events[0].device.serial_ports == std::vector<std::string>{"/dev/ttyACM2"});
+
+            // Other subsystems and repeated events change nothing
+            events.clear();
+            message = uevent("add", "/devices/virtual/net/lo", "net");
+            discovery.handleUevent(message.data(), message.size(), events);
+            message = uevent("bind", usb1 + "/1-5/1-5:1.0", "usb");
+            discovery.handleUevent(message.data(), message.size(), events);
+            REQUIRE(events.empty());
+
+            fs::remove_all(root / "bus/usb/devices/1-5");
+            message = uevent("remove", usb1 + "/1-5", "usb");
+            discovery.handleUevent(message.data(), message.size(), events);
+            REQUIRE(events.size() == 1);
+            REQUIRE(events[0].change == DeviceChange::Removed);
+            REQUIRE(discovery.device("1-5", device) == NRFDL_ERR_ARGUMENT);
+        }
+
+        fs::remove_all(root);
+    }
+}; // namespace
@@ -0,0 +1,132 @@
+#include "catch.hpp"
+#include "fmt/format.h"
+
+#include "sdfu_ihex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto record(uint8_t type, uint16_t address, const std::vector<uint8_t> & data) -> std::string
+    {
+        uint8_t sum = static_cast<uint8_t>(data.size() + (address >> 8) + (address & 0xff) + type);
+        auto line   = fmt::format(":{:02X}{:04X}{:02X}", data.size(), address, type);
+        for (auto byte : data)
+        {
+            line += fmt::format("{:02X}", byte);
+            sum += byte;
+        }
+        return line + fmt::format("{:02X}\n", static_cast<uint8_t>(-sum));
+    }
+
+    auto parse(const std::string & text, HexImage & image) -> nrfdl_errorcode_t
+    {
+        HexLoader loader;
+        return loader.parse(text.data(), text.size(), image);
+    }
+
+    TEST_CASE("Test Intel HEX", "[ihex]")
+    {
+        const std::string eof = ":00000001FF\n";
+
+        SECTION("Single record")
+        {
+            HexImage image;
+            REQUIRE(parse(":0400100001020304E2\r\n" + eof, image) == NRFDL_ERR_NONE);
+            REQUIRE(image.base == 0x10);
+            REQUIRE(image.data == std::vector<uint8_t>{1, 2, 3, 4});
+        }
+
+        SECTION("Long records with lower case digits")
+        {
+            std::vector<uint8_t> data(255);
+            for (size_t i = 0; i < data.size(); i++)
+            {
+                data[i] = static_cast<uint8_t>(i * 13);
+            }
+
+            auto text = record(0x04, 0, {0x00, 0x01}) + record(0x00, 0x0000, data) + record(0x00, 0x00ff, data) + eof;
+            std::transform(text.begin(), text.end(), text.begin(), [](char c) { return std::tolower(c); });
+
+            HexImage image;
+            REQUIRE(parse(text, image) == NRFDL_ERR_NONE);
+            REQUIRE(image.base == 0x10000);
+            REQUIRE(image.data.size() == 2 * data.size());
+            REQUIRE(std::equal(data.begin(), data.end(), image.data.begin()));
+            REQUIRE(std::equal(data.begin(), data.end(), image.data.begin() + data.size()));
+        }
+
+        SECTION("Gaps are filled")
+        {
+            const auto text = record(0x00, 0x1000, {0xaa, 0xbb}) + record(0x02, 0, {0x01, 0x00}) +
+                              record(0x00, 0x0004, {0xcc}) + eof;
+
+            HexImage image;
+            REQUIRE(parse(text, image) == NRFDL_ERR_NONE);
+            REQUIRE(image.base == 0x1000);
+            REQUIRE(image.data.size() == 5);
+            REQUIRE(image.data == std::vector<uint8_t>{0xaa, 0xbb, 0xff, 0xff, 0xcc});
+        }
+
+        SECTION("Records out of order")
+        {
+            const auto text = record(0x00, 0x0010, {0x02}) + record(0x00, 0x0000, {0x01}) + eof;
+
+            HexImage image;
+            REQUIRE(parse(text, image) == NRFDL_ERR_NONE);
+            REQUIRE(image.base == 0);
+            REQUIRE(image.data.size() == 0x11);
+            REQUIRE(image.data.front() == 0x01);
+            REQUIRE(image.data.back() == 0x02);
+        }
+
+        SECTION("Malformed input")
+        {
+            HexImage image;
+
+            // Checksum, bad digit, overlap, missing end of file, truncated record, far apart segments
+            REQUIRE(parse(":0400100001020304E3\n" + eof, image) == NRFDL_ERR_ARGUMENT);
+            REQUIRE(parse(":04001000010203G4E2\n" + eof, image) == NRFDL_ERR_ARGUMENT);
+            REQUIRE(parse(record(0x00, 0, {1, 2}) + record(0x00, 1, {3}) + eof, image) == NRFDL_ERR_ARGUMENT);
+            REQUIRE(parse(record(0x00, 0, {1, 2}), image) == NRFDL_ERR_ARGUMENT);
+            REQUIRE(parse(":04001000010203", image) == NRFDL_ERR_ARGUMENT);
+            REQUIRE(parse(record(0x00, 0, {1}) + record(0x04, 0, {0x10, 0x00}) + record(0x00, 0, {1}) + eof, image) ==
+                    NRFDL_ERR_ARGUMENT);
+        }
+
+        SECTION("Base address")
+        {
+            HexLoader loader;
+            HexImage image;
+            image.base = 0x27000;
+
+            DfuResponseFirmware firmware{DfuFirmwareType::NRF_DFU_FIRMWARE_TYPE_APPLICATION, 1, 0x27000, 0};
+            REQUIRE(loader.checkBaseAddress(image, firmware) == NRFDL_ERR_NONE);
+            firmware.addr = 0x26000;
+            REQUIRE(loader.checkBaseAddress(image, firmware) == NRFDL_ERR_ARGUMENT);
+        }
+
+        SECTION("Load file")
+        {
+            const auto path = std::string("test_sdfu_ihex.hex");
+            {
+                std::ofstream file(path);
+                file << record(0x00, 0x0100, {5, 6, 7}) << eof;
+            }
+
+            HexLoader loader;
+            HexImage image;
+            REQUIRE(loader.load(path, image) == NRFDL_ERR_NONE);
+            REQUIRE(image.base == 0x100);
+            REQUIRE(image.data == std::vector<uint8_t>{5, 6, 7});
+            std::remove(path.c_str());
+
+            REQUIRE(loader.load(path, image) == NRFDL_ERR_ARGUMENT);
+        }
+    }
+}; // namespace
@@ -0,0 +1,109 @@
+#include "catch.hpp"
+
+#include "sdfu_image_source.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto makeImage(size_t size) -> data_t
+    {
+        data_t image(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            image[i] = static_cast<uint8_t>(i * 13 + 5);
+        }
+        return image;
+    }
+
+    auto window(ImageSource & source, uint32_t offset, uint32_t size) -> data_t
+    {
+        const uint8_t * data = nullptr;
+        REQUIRE(source.read(offset, size, data) == NRFDL_ERR_NONE);
+        return data_t(data, data + size);
+    }
+
+    auto slice(const data_t & image, uint32_t offset, uint32_t size) -> data_t
+    {
+        return data_t(image.begin() + offset, image.begin() + offset + size);
+    }
+
+    TEST_CASE("Test image sources", "[image]")
+    {
+        const auto image = makeImage(10000);
+        const std::string bytes(image.begin(), image.end());
+        const uint8_t * data = nullptr;
+
+        SECTION("Memory")
+        {
+            MemoryImageSource source(image);
+            REQUIRE(source.size() == image.size());
+            REQUIRE(source.read(4096, 100, data) == NRFDL_ERR_NONE);
+            REQUIRE(data == image.data() + 4096);
+            REQUIRE(source.read(9000, 1001, data) == NRFDL_ERR_ARGUMENT);
+        }
+
+        SECTION("File")
+        {
+            const auto path = (std::filesystem::temp_directory_path() / "test_sdfu_image_source.bin").string();
+            std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+
+            {
+                FileImageSource source(path);
+                REQUIRE(source.ok());
+                REQUIRE(source.size() == image.size());
+                REQUIRE(window(source, 0, 4096) == slice(image, 0, 4096));
+                REQUIRE(window(source, 100, 200) == slice(image, 100, 200));
+                REQUIRE(window(source, 8192, 1808) == slice(image, 8192, 1808));
+                // Going back reads the file again
+                REQUIRE(window(source, 4096, 4096) == slice(image, 4096, 4096));
+                REQUIRE(source.read(8192, 4096, data) == NRFDL_ERR_ARGUMENT);
+            }
+            std::filesystem::remove(path);
+
+            FileImageSource missing(path);
+            REQUIRE_FALSE(missing.ok());
+            REQUIRE(missing.read(0, 1, data) == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+        }
+
+        SECTION("Stream")
+        {
+            std::istringstream stream(bytes);
+            StreamImageSource source(stream, static_cast<uint32_t>(image.size()));
+            REQUIRE(source.ok());
+
+            REQUIRE(window(source, 0, 4096) == slice(image, 0, 4096));
+            // Overlapping windows keep the buffered bytes, skipped bytes are dropped
+            REQUIRE(window(source, 4000, 4096) == slice(image, 4000, 4096));
+            REQUIRE(window(source, 9000, 1000) == slice(image, 9000, 1000));
+            REQUIRE(source.read(0, 4096, data) == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+            REQUIRE(source.read(9000, 1001, data) == NRFDL_ERR_ARGUMENT);
+        }
+
+        SECTION("Stream with spill file")
+        {
+            std::istringstream stream(bytes);
+            StreamImageSource source(stream, static_cast<uint32_t>(image.size()), StreamImageSource::Config{true});
+            REQUIRE(source.ok());
+
+            REQUIRE(window(source, 4096, 4096) == slice(image, 4096, 4096));
+            REQUIRE(window(source, 0, 4096) == slice(image, 0, 4096));
+            // Partly spilled, partly still in the stream
+            REQUIRE(window(source, 6000, 4000) == slice(image, 6000, 4000));
+            REQUIRE(window(source, 0, 10000) == image);
+        }
+
+        SECTION("Stream ends early")
+        {
+            std::istringstream stream(bytes.substr(0, 5000));
+            StreamImageSource source(stream, static_cast<uint32_t>(image.size()));
+            REQUIRE(window(source, 0, 4096) == slice(image, 0, 4096));
+            REQUIRE(source.read(4096, 4096, data) == NRFDL_ERR_CLOSED);
+        }
+    }
+}; // namespace
@@ -0,0 +1,129 @@
+#include "catch.hpp"
+
+#include "sdfu_model.h"
+#include "sdfu_session.h"
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    TEST_CASE("Test duration model", "[model]")
+    {
+        TransferProfile profile;
+        profile.init_size  = 140;
+        profile.image_size = 100000;
+        profile.mtu        = 131;
+        profile.max_size   = 4096;
+        profile.prn        = 8;
+
+        DurationModel model;
+
+        SECTION("Counts follow the transfer")
+        {
+            TransferCounts counts;
+            REQUIRE(model.count(profile, counts) == NRFDL_ERR_NONE);
+
+            const auto objects = (profile.image_size + profile.max_size - 1) / profile.max_size;
+            REQUIRE(counts.creates == objects + 1);
+            REQUIRE(counts.executes == objects + 1);
+            REQUIRE(counts.erased_pages == objects);
+            REQUIRE(counts.tx_bytes > profile.image_size + profile.init_size);
+
+            // Every write adds the opcode and length to the payload
+            const auto chunk  = writePayloadSize(profile.mtu);
+            const auto writes = (profile.image_size / profile.max_size) * ((profile.max_size + chunk - 1) / chunk);
+            REQUIRE(counts.requests > writes);
+        }
+
+        SECTION("Receipts add round trips")
+        {
+            auto noReceipts = profile;
+            noReceipts.prn  = 0;
+
+            TransferCounts with;
+            TransferCounts without;
+            REQUIRE(model.count(profile, with) == NRFDL_ERR_NONE);
+            REQUIRE(model.count(noReceipts, without) == NRFDL_ERR_NONE);
+            REQUIRE(with.round_trips > without.round_trips);
+            REQUIRE(with.tx_bytes == without.tx_bytes);
+        }
+
+        SECTION("Calibration recovers the link")
+        {
+            LinkParameters link;
+            link.bandwidth    = 50000;
+            link.latency      = 0.004;
+            link.create_cost  = 0.08;
+            link.execute_cost = 0.02;
+            DurationModel reference(link);
+
+            std::vector<SessionTiming> timings;
+            for (uint32_t prn : {0u, 4u, 16u})
+            {
+                for (uint32_t size : {20000u, 70000u, 150000u})
+                {
+                    for (uint32_t maxSize : {1024u, 4096u, 8192u})
+                    {
+                        SessionTiming timing;
+                        timing.profile            = profile;
+                        timing.profile.prn        = prn;
+                        timing.profile.image_size = size;
+                        timing.profile.max_size   = maxSize;
+                        REQUIRE(reference.predict(timing.profile, timing.seconds) == NRFDL_ERR_NONE);
+                        timings.push_back(timing);
+                    }
+                }
+            }
+
+            REQUIRE(model.calibrate(timings) == NRFDL_ERR_NONE);
+            REQUIRE(model.parameters().bandwidth == Approx(link.bandwidth).epsilon(0.01));
+            REQUIRE(model.parameters().latency == Approx(link.latency).epsilon(0.01));
+            REQUIRE(model.parameters().create_cost == Approx(link.create_cost).epsilon(0.01));
+            REQUIRE(model.parameters().execute_cost == Approx(link.execute_cost).epsilon(0.01));
+
+            double expected = 0;
+            double predicted = 0;
+            REQUIRE(reference.predict(profile, expected) == NRFDL_ERR_NONE);
+            REQUIRE(model.predict(profile, predicted) == NRFDL_ERR_NONE);
+            REQUIRE(predicted == Approx(expected).epsilon(0.01));
+        }
+
+        SECTION("Calibration needs data")
+        {
+            REQUIRE(model.calibrate({}) == NRFDL_ERR_ARGUMENT);
+        }
+
+        SECTION("Station shares the hub bandwidth")
+        {
+            double device = 0;
+            REQUIRE(model.predict(profile, device) == NRFDL_ERR_NONE);
+
+            StationGroup hub;
+            hub.devices.assign(4, profile);
+            hub.concurrency = 2;
+
+            double station = 0;
+            REQUIRE(model.predict(std::vector<StationGroup>{hub}, station) == NRFDL_ERR_NONE);
+            REQUIRE(station == Approx(2 * device));
+
+            hub.bandwidth = model.parameters().bandwidth;
+            double shared = 0;
+            REQUIRE(model.predict(std::vector<StationGroup>{hub}, shared) == NRFDL_ERR_NONE);
+            REQUIRE(shared > station);
+
+            // Idle sessions leave the hub to the busy ones
+            hub.devices.resize(1);
+            hub.concurrency = 4;
+            double alone    = 0;
+            REQUIRE(model.predict(std::vector<StationGroup>{hub}, alone) == NRFDL_ERR_NONE);
+            REQUIRE(alone == Approx(device));
+
+            hub.devices.clear();
+            REQUIRE(model.predict(std::vector<StationGroup>{hub}, alone) == NRFDL_ERR_NONE);
+            REQUIRE(alone == 0);
+
+            hub.concurrency = 0;
+            REQUIRE(model.predict(std::vector<StationGroup>{hub}, shared) == NRFDL_ERR_ARGUMENT);
+        }
+    }
+}; // namespace
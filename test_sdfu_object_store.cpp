@@ -0,0 +1,139 @@
+#include "catch.hpp"
+
+#include "sdfu_batch.h"
+#include "sdfu_crc32.h"
+#include "sdfu_frames.h"
+#include "sdfu_object_store.h"
+
+#include <optional>
+#include <thread>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto makeImage(size_t size, uint8_t seed) -> data_t
+    {
+        data_t image(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            image[i] = static_cast<uint8_t>((i * 11 + seed) ^ (i >> 8));
+        }
+        return image;
+    }
+
+    TEST_CASE("Test object store", "[store]")
+    {
+        ObjectStore::Config config;
+        config.object_size = 4096;
+        config.chunk       = 62;
+        ObjectStore store(config);
+
+        // Two regional variants differing in the second object only
+        const auto europe = makeImage(10000, 1);
+        auto america      = europe;
+        america[5000] ^= 0xff;
+
+        SECTION("Variants share objects")
+        {
+            auto first  = store.add(europe);
+            auto second = store.add(america);
+            REQUIRE(first.objects().size() == 3);
+            REQUIRE(store.objects() == 4);
+            // Pre-encoded writes hold the data a second time
+            const size_t writes = 3 * 67 + 30;
+            REQUIRE(store.bytes() == 2 * (10000 + 4096) + writes * Frames::writeOverhead);
+
+            REQUIRE(first.objects()[0] == second.objects()[0]);
+            REQUIRE(first.objects()[1] != second.objects()[1]);
+            REQUIRE(first.objects()[2] == second.objects()[2]);
+            REQUIRE(first.objects()[2]->crc == crc32(europe.data() + 8192, 1808));
+
+            // Repeated objects within one image are shared as well
+            {
+                const auto padding = store.add(data_t(8192, 0xff));
+                REQUIRE(padding.objects()[0] == padding.objects()[1]);
+                REQUIRE(store.objects() == 5);
+            }
+
+            // Objects go with the last image using them
+            {
+                const auto third = store.add(europe);
+                REQUIRE(store.objects() == 4);
+            }
+            std::optional<StoredImage> copy(first);
+            first  = store.add(data_t{});
+            second = store.add(data_t{});
+            REQUIRE(store.objects() == 3);
+            copy.reset();
+            REQUIRE(store.objects() == 0);
+            REQUIRE(store.bytes() == 0);
+        }
+
+        SECTION("Concurrent adds share objects")
+        {
+            std::vector<StoredImage> images(4, store.add(data_t{}));
+            std::vector<std::thread> threads;
+            for (auto & image : images)
+            {
+                threads.emplace_back([&store, &image, &europe] { image = store.add(europe); });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            REQUIRE(store.objects() == 3);
+            for (const auto & image : images)
+            {
+                REQUIRE(image.objects() == images[0].objects());
+            }
+        }
+
+        SECTION("Windows")
+        {
+            auto image           = store.add(europe);
+            const uint8_t * data = nullptr;
+
+            REQUIRE(image.size() == europe.size());
+            REQUIRE(image.read(4096, 4096, data) == NRFDL_ERR_NONE);
+            REQUIRE(data == image.objects()[1]->data.data());
+
+            // Spanning objects copies
+            REQUIRE(image.read(4000, 5000, data) == NRFDL_ERR_NONE);
+            REQUIRE(data_t(data, data + 5000) == data_t(europe.begin() + 4000, europe.begin() + 9000));
+            REQUIRE(image.read(9000, 1001, data) == NRFDL_ERR_ARGUMENT);
+
+            uint32_t crc = 0;
+            REQUIRE(image.crc(0, 8192, crc));
+            REQUIRE(crc == crc32(europe.data(), 8192));
+            REQUIRE(image.crc(8192, 1808, crc));
+            REQUIRE(crc == crc32(europe.data(), europe.size()));
+            REQUIRE_FALSE(image.crc(100, 4096, crc));
+        }
+
+        SECTION("Pre-encoded writes")
+        {
+            auto image = store.add(europe);
+            REQUIRE(image.frames(4096, 4096, 62) == image.objects()[1]->frames.data());
+            REQUIRE(image.frames(4096, 4096, 61) == nullptr);
+            REQUIRE(image.frames(4096, 2048, 62) == nullptr);
+            REQUIRE(image.frames(100, 4096, 62) == nullptr);
+
+            // Byte for byte the frames of zero copy writes
+            FrameBatch batch;
+            for (uint32_t offset = 8192; offset < europe.size(); offset += 62)
+            {
+                const auto size = static_cast<uint16_t>(std::min<size_t>(62, europe.size() - offset));
+                REQUIRE(batch.addWrite(europe.data() + offset, size) == NRFDL_ERR_NONE);
+            }
+            data_t expected;
+            for (const auto & vector : batch.iovecs())
+            {
+                const auto base = static_cast<const uint8_t *>(vector.iov_base);
+                expected.insert(expected.end(), base, base + vector.iov_len);
+            }
+            REQUIRE(image.objects()[2]->frames == expected);
+        }
+    }
+}; // namespace
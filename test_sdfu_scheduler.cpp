@@ -0,0 +1,80 @@
+#include "catch.hpp"
+
+#include "sdfu_scheduler.h"
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    TEST_CASE("Test hub scheduler", "[scheduler]")
+    {
+        using namespace std::chrono_literals;
+
+        HubScheduler::Config config;
+        config.initial_concurrency = 2;
+        config.initial_prn         = 8;
+        config.window              = 1s;
+
+        HubScheduler scheduler(config);
+        const auto t0 = HubScheduler::Clock::time_point{};
+
+        SECTION("Group from topology path")
+        {
+            REQUIRE(HubScheduler::groupOf("1-2.3.4") == "1-2.3");
+            REQUIRE(HubScheduler::groupOf("/sys/bus/usb/devices/1-2.3.4:1.0") == "1-2.3");
+            REQUIRE(HubScheduler::groupOf("3-1") == "usb3");
+        }
+
+        SECTION("Admission respects the group limit")
+        {
+            HubScheduler::Admission a, b, c, d;
+            REQUIRE(scheduler.tryAdmit("1-2", a, t0) == NRFDL_ERR_NONE);
+            REQUIRE(a.prn == 8);
+            REQUIRE(scheduler.tryAdmit("1-2", b, t0) == NRFDL_ERR_NONE);
+            REQUIRE(scheduler.tryAdmit("1-2", c, t0) == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+
+            // Other hubs are independent
+            REQUIRE(scheduler.tryAdmit("1-3", d, t0) == NRFDL_ERR_NONE);
+
+            scheduler.release(a, t0);
+            REQUIRE(scheduler.tryAdmit("1-2", c, t0) == NRFDL_ERR_NONE);
+        }
+
+        SECTION("Growing throughput raises concurrency")
+        {
+            HubScheduler::Admission a, b;
+            REQUIRE(scheduler.tryAdmit("1-2", a, t0) == NRFDL_ERR_NONE);
+            REQUIRE(scheduler.tryAdmit("1-2", b, t0) == NRFDL_ERR_NONE);
+
+            scheduler.reportProgress(a, 100000, t0 + 500ms);
+            scheduler.reportProgress(b, 100000, t0 + 1s);
+
+            HubScheduler::GroupStats stats;
+            REQUIRE(scheduler.stats("1-2", stats) == NRFDL_ERR_NONE);
+            REQUIRE(stats.limit == 3);
+            REQUIRE(stats.prn == 16);
+            REQUIRE(stats.throughput == Approx(200000));
+        }
+
+        SECTION("Errors halve concurrency and PRN")
+        {
+            HubScheduler::Admission a, b;
+            REQUIRE(scheduler.tryAdmit("1-2", a, t0) == NRFDL_ERR_NONE);
+            REQUIRE(scheduler.tryAdmit("1-2", b, t0) == NRFDL_ERR_NONE);
+
+            scheduler.reportError(a, NRFDL_ERR_PROTOCOL, t0 + 200ms);
+            scheduler.reportProgress(b, 1000, t0 + 1s);
+
+            HubScheduler::GroupStats stats;
+            REQUIRE(scheduler.stats("1-2", stats) == NRFDL_ERR_NONE);
+            REQUIRE(stats.limit == 1);
+            REQUIRE(stats.prn == 4);
+        }
+
+        SECTION("Unknown group")
+        {
+            HubScheduler::GroupStats stats;
+            REQUIRE(scheduler.stats("9-9", stats) == NRFDL_ERR_ARGUMENT);
+        }
+    }
+}; // namespace
@@ -0,0 +1,477 @@
+#include "catch.hpp"
+#include "fmt/format.h"
+
+#include "sdfu_bootloader_sim.h"
+#include "sdfu_codec.h"
+#include "sdfu_crc32.h"
+#include "sdfu_image_source.h"
+#include "sdfu_object_store.h"
+#include "sdfu_session.h"
+#include "sdfu_sha256.h"
+
+#include <memory_resource>
+#include <sstream>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    auto makeImage(size_t size, uint8_t seed) -> data_t
+    {
+        data_t image(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            image[i] = static_cast<uint8_t>(i * 31 + seed);
+        }
+        return image;
+    }
+
+    // Drive the session until it ends or the given number of requests has been sent
+    auto run(Session & session, SimBootloader & device, size_t limit = SIZE_MAX) -> nrfdl_errorcode_t
+    {
+        Codec codec;
+        DfuRequest request;
+        DfuResponse response;
+        data_t packet;
+        data_t reply;
+
+        for (size_t sent = 0; sent < limit && !session.done(); sent++)
+        {
+            auto error = session.next(request);
+            if (error != NRFDL_ERR_NONE)
+            {
+                return error;
+            }
+
+            REQUIRE(codec.encode(request, packet) == NRFDL_ERR_NONE);
+            REQUIRE(device.process(packet, reply) == NRFDL_ERR_NONE);
+
+            if (!reply.empty())
+            {
+                REQUIRE(codec.decode(reply, response) == NRFDL_ERR_NONE);
+                error = session.handle(response);
+                if (error != NRFDL_ERR_NONE)
+                {
+                    return error;
+                }
+            }
+        }
+        return NRFDL_ERR_NONE;
+    }
+
+    // Upstream resource counting what the session arena takes from it
+    class CountingResource : public std::pmr::memory_resource
+    {
+      public:
+        size_t allocations = 0;
+        size_t bytes       = 0;
+
+      private:
+        auto do_allocate(size_t size, size_t alignment) -> void * override
+        {
+            allocations++;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        auto do_deallocate(void * p, size_t size, size_t alignment) -> void override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+
+        auto do_is_equal(const std::pmr::memory_resource & other) const noexcept -> bool override
+        {
+            return this == &other;
+        }
+    };
+
+    TEST_CASE("Test CRC32", "[sdfu]")
+    {
+        const std::string check = "123456789";
+        const auto data         = reinterpret_cast<const uint8_t *>(check.data());
+
+        REQUIRE(crc32(data, check.size()) == 0xCBF43926);
+        REQUIRE(crc32(data + 4, check.size() - 4, crc32(data, 4)) == 0xCBF43926);
+        REQUIRE(crc32(data, 0) == 0);
+
+        REQUIRE(crc32Combine(crc32(data, 4), crc32(data + 4, check.size() - 4), check.size() - 4) == 0xCBF43926);
+        REQUIRE(crc32Combine(0xCBF43926, 0, 0) == 0xCBF43926);
+        const auto image = makeImage(100000, 3);
+        REQUIRE(crc32Combine(crc32(image.data(), 4096), crc32(image.data() + 4096, 95904), 95904) ==
+                crc32(image.data(), image.size()));
+    }
+
+    TEST_CASE("Test SHA-256", "[sdfu]")
+    {
+        const auto hex = [](const Sha256Digest & digest) {
+            std::string text;
+            for (auto byte : digest)
+            {
+                text += fmt::format("{:02x}", byte);
+            }
+            return text;
+        };
+
+        const std::string abc = "abc";
+        REQUIRE(hex(sha256(reinterpret_cast<const uint8_t *>(abc.data()), abc.size())) ==
+                "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        REQUIRE(hex(sha256(nullptr, 0)) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+        // Updates that do not line up with the 64 byte blocks
+        const auto image = makeImage(10000, 7);
+        Sha256 hash;
+        for (size_t offset = 0; offset < image.size(); offset += 61)
+        {
+            hash.update(image.data() + offset, std::min<size_t>(61, image.size() - offset));
+        }
+        REQUIRE(hash.final() == sha256(image.data(), image.size()));
+    }
+
+    TEST_CASE("Test session", "[session]")
+    {
+        const auto init     = makeImage(140, 1);
+        const auto firmware = makeImage(10000, 2);
+
+        SimBootloader::Config bootloader;
+        bootloader.mtu           = 131;
+        bootloader.data_max_size = 4096;
+
+        SECTION("Transfer without receipts")
+        {
+            SimBootloader device(bootloader);
+            Session session(init, firmware);
+
+            REQUIRE(run(session, device) == NRFDL_ERR_NONE);
+            REQUIRE(session.done());
+            REQUIRE(session.chunkSize() == writePayloadSize(131));
+            REQUIRE(device.command() == init);
+            REQUIRE(device.firmware() == firmware);
+            REQUIRE(device.executedSize() == firmware.size());
+        }
+
+        SECTION("Transfer with receipts")
+        {
+            Session::Config config;
+            config.prn = 3;
+
+            SimBootloader device(bootloader);
+            Session session(init, firmware, config);
+
+            REQUIRE(run(session, device) == NRFDL_ERR_NONE);
+            REQUIRE(session.done());
+            REQUIRE(device.firmware() == firmware);
+        }
+
+        SECTION("Arena")
+        {
+            CountingResource upstream;
+            Session::Config config;
+            config.memory = &upstream;
+
+            SimBootloader device(bootloader);
+            {
+                Session session(init, firmware, config);
+                REQUIRE(run(session, device) == NRFDL_ERR_NONE);
+                REQUIRE(device.firmware() == firmware);
+
+                // One buffer holding a data object serves the command and all three data objects
+                REQUIRE(upstream.allocations == 1);
+                REQUIRE(upstream.bytes == bootloader.data_max_size);
+            }
+
+            // Payloads of decoded writes come from the resource given to the codec
+            std::pmr::monotonic_buffer_resource arena(&upstream);
+            Codec codec(&arena);
+            DfuRequest request;
+            REQUIRE(codec.decode(data_t{0x08, 0x0a, 0x0b, 0x02, 0x00}, request) == NRFDL_ERR_NONE);
+            REQUIRE(std::get<DfuRequestWrite>(*request.request).data.get_allocator().resource() == &arena);
+        }
+
+        SECTION("Response timeouts")
+        {
+            Codec codec;
+            DfuRequest request;
+            DfuResponse response;
+            data_t packet;
+            data_t reply;
+
+            // Every third response is lost, the request it answered goes out again
+            SimBootloader device(bootloader);
+            Session session(init, firmware);
+            REQUIRE(session.timeout() == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+
+            size_t responses = 0;
+            size_t timeouts  = 0;
+            while (!session.done())
+            {
+                REQUIRE(session.next(request) == NRFDL_ERR_NONE);
+                REQUIRE(codec.encode(request, packet) == NRFDL_ERR_NONE);
+                REQUIRE(device.process(packet, reply) == NRFDL_ERR_NONE);
+                if (reply.empty())
+                {
+                    continue;
+                }
+
+                if (++responses % 3 == 0)
+                {
+                    REQUIRE(session.timeout() == NRFDL_ERR_NONE);
+                    timeouts++;
+                    continue;
+                }
+                REQUIRE(codec.decode(reply, response) == NRFDL_ERR_NONE);
+                REQUIRE(session.handle(response) == NRFDL_ERR_NONE);
+            }
+            REQUIRE(timeouts > 3);
+            REQUIRE(device.firmware() == firmware);
+            REQUIRE(device.executedSize() == firmware.size());
+        }
+
+        SECTION("Receipt timeout restarts the object")
+        {
+            Session::Config config;
+            config.prn         = 2;
+            config.max_retries = 1;
+
+            SimBootloader device(bootloader);
+            Session session(init, firmware, config);
+            DfuRequest request;
+
+            // PRN, MTU, select, create and a write, then the write asking for the first receipt
+            REQUIRE(run(session, device, 5) == NRFDL_ERR_NONE);
+            REQUIRE(session.next(request) == NRFDL_ERR_NONE);
+            REQUIRE(session.awaiting() == DfuOpcode::NRF_DFU_OP_OBJECT_WRITE);
+            REQUIRE(session.timeout() == NRFDL_ERR_NONE);
+            REQUIRE(session.state() == Session::State::CommandCreate);
+            REQUIRE(session.offset() == 0);
+
+            REQUIRE(session.next(request) == NRFDL_ERR_NONE);
+            REQUIRE(request.opcode == DfuOpcode::NRF_DFU_OP_OBJECT_CREATE);
+            REQUIRE(session.timeout() == NRFDL_ERR_PROTOCOL);
+            REQUIRE(session.failed());
+        }
+
+        SECTION("Resume an interrupted transfer")
+        {
+            SimBootloader device(bootloader);
+
+            // Stop in the middle of the second data object
+            Session first(init, firmware);
+            REQUIRE(run(first, device, 100) == NRFDL_ERR_NONE);
+            REQUIRE(device.firmware().size() > bootloader.data_max_size);
+            REQUIRE(device.executedSize() == bootloader.data_max_size);
+
+            Session second(init, firmware);
+            REQUIRE(run(second, device) == NRFDL_ERR_NONE);
+            REQUIRE(second.done());
+            REQUIRE(device.firmware() == firmware);
+        }
+
+        SECTION("Resume with receipts")
+        {
+            Session::Config config;
+            config.prn = 4;
+
+            SimBootloader device(bootloader);
+            Session first(init, firmware, config);
+            REQUIRE(run(first, device, 100) == NRFDL_ERR_NONE);
+
+            // The command object writes leave the bootloader receipt counter out of step with the resumed object
+            Session second(init, firmware, config);
+            REQUIRE(run(second, device) == NRFDL_ERR_NONE);
+            REQUIRE(second.done());
+            REQUIRE(device.firmware() == firmware);
+        }
+
+        SECTION("Firmware hash")
+        {
+            Session::Config config;
+            config.sha256 = sha256(firmware.data(), firmware.size());
+
+            SimBootloader device(bootloader);
+            Session session(init, firmware, config);
+
+            REQUIRE(run(session, device) == NRFDL_ERR_NONE);
+            REQUIRE(session.done());
+            REQUIRE(device.firmware() == firmware);
+        }
+
+        SECTION("Firmware hash after resume")
+        {
+            Session::Config config;
+            config.sha256 = sha256(firmware.data(), firmware.size());
+
+            SimBootloader device(bootloader);
+            Session first(init, firmware, config);
+            REQUIRE(run(first, device, 100) == NRFDL_ERR_NONE);
+
+            Session second(init, firmware, config);
+            REQUIRE(run(second, device) == NRFDL_ERR_NONE);
+            REQUIRE(second.done());
+        }
+
+        SECTION("Streamed firmware")
+        {
+            Session::Config config;
+            config.prn    = 4;
+            config.sha256 = sha256(firmware.data(), firmware.size());
+
+            std::istringstream stream(std::string(firmware.begin(), firmware.end()));
+            StreamImageSource source(stream, static_cast<uint32_t>(firmware.size()));
+
+            SimBootloader device(bootloader);
+            Session session(init, source, config);
+            REQUIRE(run(session, device) == NRFDL_ERR_NONE);
+            REQUIRE(session.done());
+            REQUIRE(device.firmware() == firmware);
+        }
+
+        SECTION("Resume a streamed transfer")
+        {
+            Session::Config config;
+            config.sha256 = sha256(firmware.data(), firmware.size());
+
+            std::istringstream stream(std::string(firmware.begin(), firmware.end()));
+            StreamImageSource source(stream, static_cast<uint32_t>(firmware.size()));
+
+            SimBootloader device(bootloader);
+            Session first(init, source, config);
+            REQUIRE(run(first, device, 100) == NRFDL_ERR_NONE);
+
+            // The new session reads the image from the start again, the stream cannot go back
+            Session second(init, source, config);
+            REQUIRE(run(second, device) == NRFDL_ERR_PROTOCOL);
+            REQUIRE(second.failed());
+
+            std::istringstream spilled(std::string(firmware.begin(), firmware.end()));
+            const StreamImageSource::Config spill{true};
+            StreamImageSource spilling(spilled, static_cast<uint32_t>(firmware.size()), spill);
+            SimBootloader other(bootloader);
+
+            Session third(init, spilling, config);
+            REQUIRE(run(third, other, 100) == NRFDL_ERR_NONE);
+
+            Session fourth(init, spilling, config);
+            REQUIRE(run(fourth, other) == NRFDL_ERR_NONE);
+            REQUIRE(fourth.done());
+            REQUIRE(other.firmware() == firmware);
+        }
+
+        SECTION("Resume from an object store")
+        {
+            ObjectStore store;
+            auto image = store.add(firmware);
+
+            SimBootloader device(bootloader);
+            Session first(init, image);
+            REQUIRE(run(first, device, 100) == NRFDL_ERR_NONE);
+
+            // The CRC of the objects sent already is combined from the stored object CRCs
+            Session second(init, image);
+            REQUIRE(run(second, device) == NRFDL_ERR_NONE);
+            REQUIRE(second.done());
+            REQUIRE(device.firmware() == firmware);
+        }
+
+        SECTION("Object CRCs from the store")
+        {
+            // Store whose CRC of the second object is off, the bytes are right
+            class WrongCrc : public ImageSource
+            {
+              public:
+                explicit WrongCrc(StoredImage & image)
+                    : _image(image)
+                {}
+
+                auto size() const -> uint32_t override
+                {
+                    return _image.size();
+                }
+                auto read(uint32_t offset, uint32_t size, const uint8_t *& data) -> nrfdl_errorcode_t override
+                {
+                    return _image.read(offset, size, data);
+                }
+                auto crc(uint32_t offset, uint32_t size, uint32_t & crc) -> bool override
+                {
+                    const auto known = _image.crc(offset, size, crc);
+                    crc ^= (offset == 4096) ? 1 : 0;
+                    return known;
+                }
+
+              private:
+                StoredImage & _image;
+            };
+
+            ObjectStore store;
+            auto image = store.add(firmware);
+            WrongCrc source(image);
+
+            // Without receipts the session takes the object CRC from the source instead of computing it
+            SimBootloader device(bootloader);
+            Session session(init, source);
+            REQUIRE(run(session, device) == NRFDL_ERR_PROTOCOL);
+            REQUIRE(session.failed());
+
+            // Receipts need the CRC after every write, which the session computes itself
+            Session::Config config;
+            config.prn = 2;
+            SimBootloader other(bootloader);
+            Session receipts(init, source, config);
+            REQUIRE(run(receipts, other) == NRFDL_ERR_NONE);
+            REQUIRE(receipts.done());
+            REQUIRE(other.firmware() == firmware);
+        }
+
+        SECTION("Firmware hash mismatch fails before the last write")
+        {
+            Session::Config config;
+            config.sha256 = sha256(init.data(), init.size());
+
+            SimBootloader device(bootloader);
+            Session session(init, firmware, config);
+
+            REQUIRE(run(session, device) == NRFDL_ERR_PROTOCOL);
+            REQUIRE(session.failed());
+            REQUIRE(device.firmware().size() < firmware.size());
+            REQUIRE(device.executedSize() < firmware.size());
+        }
+
+        SECTION("New init packet restarts the transfer")
+        {
+            SimBootloader device(bootloader);
+
+            Session first(init, firmware);
+            REQUIRE(run(first, device, 100) == NRFDL_ERR_NONE);
+
+            const auto otherInit     = makeImage(140, 3);
+            const auto otherFirmware = makeImage(6000, 4);
+            Session second(otherInit, otherFirmware);
+            REQUIRE(run(second, device) == NRFDL_ERR_NONE);
+            REQUIRE(device.firmware() == otherFirmware);
+        }
+
+        SECTION("Oversized init packet fails")
+        {
+            const auto bigInit = makeImage(bootloader.command_max_size + 1, 5);
+
+            SimBootloader device(bootloader);
+            Session session(bigInit, firmware);
+
+            REQUIRE(run(session, device) == NRFDL_ERR_PROTOCOL);
+            REQUIRE(session.failed());
+
+            DfuRequest request;
+            REQUIRE(session.next(request) == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+        }
+
+        SECTION("Next while waiting for a response")
+        {
+            Session session(init, firmware);
+            DfuRequest request;
+
+            REQUIRE(session.next(request) == NRFDL_ERR_NONE);
+            REQUIRE(request.opcode == DfuOpcode::NRF_DFU_OP_RECEIPT_NOTIF_SET);
+            REQUIRE(session.awaitingResponse());
+            REQUIRE(session.next(request) == NRFDL_ERR_RESOURCE_ILLEGAL_STATE);
+        }
+    }
+}; // namespace
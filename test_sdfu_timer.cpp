@@ -0,0 +1,130 @@
+#include "catch.hpp"
+
+#include "sdfu_timer.h"
+
+#include <random>
+
+using namespace NRFDL::SDFU;
+
+namespace
+{
+    using std::chrono::milliseconds;
+
+    TEST_CASE("Test timer wheel", "[timer]")
+    {
+        const TimerWheel::Clock::time_point start;
+        TimerWheel wheel(milliseconds(1), start);
+        std::vector<uint64_t> expired;
+
+        SECTION("Arm, cancel and expire")
+        {
+            wheel.arm(start + milliseconds(5), 5);
+            wheel.arm(start + milliseconds(3), 3);
+            const auto late = wheel.arm(start + milliseconds(300), 300);
+            REQUIRE(wheel.armed() == 3);
+            REQUIRE(wheel.nextExpiry() == start + milliseconds(3));
+
+            wheel.advance(start + milliseconds(4), expired);
+            REQUIRE(expired == std::vector<uint64_t>{3});
+
+            REQUIRE(wheel.cancel(late));
+            REQUIRE_FALSE(wheel.cancel(late));
+
+            // The freed timer is reused, the old handle stays invalid
+            const auto reused = wheel.arm(start + milliseconds(6), 6);
+            REQUIRE(reused != late);
+            REQUIRE_FALSE(wheel.cancel(late));
+
+            expired.clear();
+            wheel.advance(start + milliseconds(1000), expired);
+            REQUIRE(expired == std::vector<uint64_t>{5, 6});
+            REQUIRE(wheel.armed() == 0);
+            REQUIRE_FALSE(wheel.nextExpiry());
+            REQUIRE_FALSE(wheel.cancel(reused));
+
+            // Deadlines in the past expire at the next tick
+            wheel.arm(start, 1);
+            expired.clear();
+            wheel.advance(start + milliseconds(1000), expired);
+            REQUIRE(expired.empty());
+            wheel.advance(start + milliseconds(1001), expired);
+            REQUIRE(expired == std::vector<uint64_t>{1});
+        }
+
+        SECTION("Expiry across levels")
+        {
+            // Deadlines up to 20 minutes reach the third level
+            std::mt19937_64 random(7);
+            std::uniform_int_distribution<int64_t> deadline(1, 20 * 60 * 1000);
+            std::vector<int64_t> deadlines(5000);
+            std::vector<TimerWheel::Handle> handles;
+            for (size_t i = 0; i < deadlines.size(); i++)
+            {
+                deadlines[i] = deadline(random);
+                handles.push_back(wheel.arm(start + milliseconds(deadlines[i]), i));
+            }
+
+            // Cancel every tenth
+            for (size_t i = 0; i < handles.size(); i += 10)
+            {
+                REQUIRE(wheel.cancel(handles[i]));
+            }
+
+            std::vector<bool> seen(deadlines.size());
+            std::uniform_int_distribution<int64_t> step(1, 5000);
+            for (int64_t now = 0; now <= 20 * 60 * 1000;)
+            {
+                const auto bound = wheel.nextExpiry();
+                now += step(random);
+
+                expired.clear();
+                wheel.advance(start + milliseconds(now), expired);
+                for (const auto cookie : expired)
+                {
+                    REQUIRE(cookie % 10 != 0);
+                    REQUIRE_FALSE(seen[cookie]);
+                    REQUIRE(deadlines[cookie] <= now);
+                    REQUIRE(bound <= start + milliseconds(deadlines[cookie]));
+                    seen[cookie] = true;
+                }
+            }
+
+            for (size_t i = 0; i < deadlines.size(); i++)
+            {
+                REQUIRE(seen[i] == (i % 10 != 0));
+            }
+            REQUIRE(wheel.armed() == 0);
+        }
+    }
+
+    TEST_CASE("Test request timers", "[timer]")
+    {
+        const RequestTimers::Clock::time_point start;
+        RequestTimers timers(TimeoutPolicy{}, milliseconds(1), start);
+        std::vector<RequestTimers::Expiry> expired;
+
+        REQUIRE(TimeoutPolicy{}.timeout(DfuOpcode::NRF_DFU_OP_CRC_GET) == milliseconds(500));
+        REQUIRE(TimeoutPolicy{}.timeout(DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE) == milliseconds(10000));
+
+        timers.start(1, DfuOpcode::NRF_DFU_OP_OBJECT_CREATE, start);
+        timers.start(2, DfuOpcode::NRF_DFU_OP_CRC_GET, start);
+        timers.start(3, DfuOpcode::NRF_DFU_OP_CRC_GET, start);
+        REQUIRE(timers.pending() == 3);
+
+        // Session 3 got its response, session 2 sent the next request
+        timers.stop(3);
+        timers.start(2, DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE, start + milliseconds(100));
+
+        timers.expire(start + milliseconds(4999), expired);
+        REQUIRE(expired.empty());
+
+        timers.expire(start + milliseconds(10100), expired);
+        REQUIRE(expired.size() == 2);
+        REQUIRE(expired[0].session == 1);
+        REQUIRE(expired[0].opcode == DfuOpcode::NRF_DFU_OP_OBJECT_CREATE);
+        REQUIRE(expired[1].session == 2);
+        REQUIRE(expired[1].opcode == DfuOpcode::NRF_DFU_OP_OBJECT_EXECUTE);
+        REQUIRE(timers.pending() == 0);
+        REQUIRE_FALSE(timers.nextExpiry());
+    }
+}; // namespace